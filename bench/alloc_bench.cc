@@ -0,0 +1,80 @@
+/**
+ * Liczba alokacji pamięci i czas na operację dla arytmetyki na małych liczbach
+ * (mieszczących się w jednej lub dwóch cyfrach BaseType). Alokacje zliczane są
+ * przez podmienione globalne operatory new/delete.
+ *
+ * Kompilacja: g++ -std=c++17 -O2 -I.. alloc_bench.cc ../very_long_int*.cc
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include "very_long_int.h"
+
+namespace
+{
+unsigned long long allocationCount = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    allocationCount++;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+
+template <typename F>
+void measure(const char* name, F f)
+{
+    const unsigned iterations = 1000000;
+    //Rozgrzewka: statyczne obiekty (np. NaN()) alokują przy pierwszym użyciu
+    f();
+    unsigned long long before = allocationCount;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; i++)
+        f();
+    auto end = std::chrono::steady_clock::now();
+    double allocations = static_cast<double> (allocationCount - before) / iterations;
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    std::cout << name << '\t' << allocations << '\t' << ns << '\n';
+}
+
+}
+
+int main()
+{
+    VeryLongInt a(123456789);
+    VeryLongInt b(987654321);
+    VeryLongInt big("340282366920938463463374607431768211455"); //2^128 - 1
+    VeryLongInt sink;
+    volatile bool flag = false;
+
+    std::cout << "operation\tallocations_per_op\tns_per_op\n";
+    measure("construct(int)", [&] { sink = VeryLongInt(42); });
+    measure("copy", [&] { VeryLongInt c(a); sink = c; });
+    measure("a + b", [&] { sink = a + b; });
+    measure("a - b", [&] { sink = b - a; });
+    measure("a * b", [&] { sink = a * b; });
+    measure("big * big", [&] { sink = big * big; });
+    measure("big / a", [&] { sink = big / a; });
+    measure("big % b", [&] { sink = big % b; });
+    measure("x += 1", [&] { sink += 1; });
+    measure("x * 10", [&] { sink = a * 10; });
+    measure("a << 70", [&] { sink = a << 70; });
+    measure("a < b", [&] { flag = a < b; });
+    return flag ? 0 : 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * Porównanie mnożenia "cyfra po cyfrze" (operator*=) z poprzednią wersją
+ * opartą na przesunięciach i dodawaniu (odtworzoną poniżej za pomocą
+ * publicznych operatorów <<= i +=).
+ *
+ * Kompilacja: g++ -std=c++17 -O2 -I.. mul_bench.cc ../very_long_int*.cc
+ */
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+#include "very_long_int.h"
+
+namespace
+{
+
+std::vector<BaseType> randomLimbs(std::size_t n, std::mt19937_64& gen)
+{
+    std::vector<BaseType> limbs(n);
+    for (auto& limb : limbs)
+        limb = gen();
+    //Najstarsza cyfra niezerowa, aby liczba miała dokładnie n cyfr
+    limbs.back() |= static_cast<BaseType> (1) << 63;
+    return limbs;
+}
+
+VeryLongInt fromLimbs(const std::vector<BaseType>& limbs)
+{
+    VeryLongInt ret;
+    for (std::size_t i = limbs.size(); i > 0; i--)
+    {
+        ret <<= std::numeric_limits<BaseType>::digits;
+        ret += limbs[i - 1];
+    }
+    return ret;
+}
+
+//Poprzedni algorytm: dla każdego ustawionego bitu mnożnika przesuwamy
+//kopię mnożnej i dodajemy ją do wyniku
+VeryLongInt shiftAndAddMultiply(const VeryLongInt& lhs, const std::vector<BaseType>& rhsLimbs)
+{
+    VeryLongInt result;
+    VeryLongInt lhsCopy = lhs;
+    unsigned long long toShift = 0;
+    for (BaseType b : rhsLimbs)
+    {
+        for (int j = 0; j < std::numeric_limits<BaseType>::digits; j++)
+        {
+            if ((b & 1) == 1)
+            {
+                lhsCopy <<= toShift;
+                toShift = 0;
+                result += lhsCopy;
+            }
+            b >>= 1;
+            toShift++;
+        }
+    }
+    return result;
+}
+
+template <typename F>
+double nanosecondsPerCall(F f, unsigned iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; i++)
+        f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+}
+
+int main()
+{
+    std::mt19937_64 gen(42);
+    std::cout << "limbs\tshift_and_add_ns\tbasecase_ns\tspeedup\n";
+    for (std::size_t n : {1, 10, 100, 1000})
+    {
+        auto aLimbs = randomLimbs(n, gen);
+        auto bLimbs = randomLimbs(n, gen);
+        VeryLongInt a = fromLimbs(aLimbs);
+        VeryLongInt b = fromLimbs(bLimbs);
+
+        if (shiftAndAddMultiply(a, bLimbs) != a * b)
+        {
+            std::cerr << "wyniki różnią się dla " << n << " cyfr\n";
+            return 1;
+        }
+
+        unsigned oldIterations = n >= 1000 ? 1 : n >= 100 ? 10 : 1000;
+        unsigned newIterations = n >= 1000 ? 20 : n >= 100 ? 1000 : 100000;
+        VeryLongInt sink;
+        double oldNs = nanosecondsPerCall([&] { sink = shiftAndAddMultiply(a, bLimbs); }, oldIterations);
+        double newNs = nanosecondsPerCall([&] { sink = a * b; }, newIterations);
+        std::cout << n << '\t' << oldNs << '\t' << newNs << '\t' << oldNs / newNs << '\n';
+    }
+    return 0;
+}
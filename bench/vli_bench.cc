@@ -0,0 +1,236 @@
+/**
+ * Pomiar czasu podstawowych operacji na liczbach od 1 do 10^6 cyfr BaseType
+ * (potęgowanie modularne do 100 cyfr).
+ * Wyniki wypisywane są w formacie CSV (domyślnie) lub JSON, aby można było
+ * porównywać kolejne wersje i dobierać progi algorytmów.
+ *
+ * Użycie: vli_bench [--format csv|json] [--max-limbs N] [--min-time sekundy] [--threads N]
+ * (--threads ustawia setThreadLimit, 0 - liczba wątków sprzętowych)
+ */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "very_long_int.h"
+
+namespace
+{
+
+struct Options
+{
+    bool json = false;
+    std::size_t maxLimbs = 1000000;
+    double minTime = 0.1;
+    unsigned threads = 1;
+};
+
+struct Result
+{
+    std::string operation;
+    std::size_t limbs;
+    unsigned long long iterations;
+    double nsPerOp;
+};
+
+std::vector<BaseType> randomLimbs(std::size_t n, std::mt19937_64& gen)
+{
+    std::vector<BaseType> limbs(n);
+    for (auto& limb : limbs)
+        limb = gen();
+    //Najstarsza cyfra niezerowa, aby liczba miała dokładnie n cyfr
+    limbs.back() |= static_cast<BaseType> (1) << 63;
+    return limbs;
+}
+
+//Składanie z połówek - liniowe dodawanie cyfra po cyfrze byłoby kwadratowe
+VeryLongInt fromLimbs(const BaseType* limbs, std::size_t n)
+{
+    if (n == 1)
+        return VeryLongInt(limbs[0]);
+    std::size_t half = n / 2;
+    VeryLongInt high = fromLimbs(limbs + half, n - half);
+    high <<= static_cast<unsigned long long> (half) * std::numeric_limits<BaseType>::digits;
+    return high + fromLimbs(limbs, half);
+}
+
+VeryLongInt randomNumber(std::size_t n, std::mt19937_64& gen)
+{
+    std::vector<BaseType> limbs = randomLimbs(n, gen);
+    return fromLimbs(limbs.data(), n);
+}
+
+//Powtarza f w coraz większych seriach, aż seria potrwa co najmniej minTime sekund
+template <typename F>
+Result measure(const char* operation, std::size_t limbs, double minTime, F f)
+{
+    f(); //rozgrzewka (m.in. tablica potęg dziesięciu przy konwersjach)
+    unsigned long long iterations = 1;
+    while (true)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long long i = 0; i < iterations; i++)
+            f();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        if (ns >= minTime * 1e9 || iterations >= (1ULL << 40))
+            return Result{operation, limbs, iterations, ns / iterations};
+        iterations *= 2;
+    }
+}
+
+void printCsv(const std::vector<Result>& results)
+{
+    std::cout << "operation,limbs,iterations,ns_per_op,ns_per_limb\n";
+    for (const Result& r : results)
+        std::cout << r.operation << ',' << r.limbs << ',' << r.iterations << ','
+                  << r.nsPerOp << ',' << r.nsPerOp / r.limbs << '\n';
+}
+
+void printJson(const std::vector<Result>& results)
+{
+    std::cout << "{\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+        std::cout << "    {\"operation\": \"" << r.operation << "\", \"limbs\": " << r.limbs
+                  << ", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.nsPerOp
+                  << ", \"ns_per_limb\": " << r.nsPerOp / r.limbs << '}'
+                  << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    std::cout << "  ]\n}\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "--format") == 0)
+        {
+            std::string format = argv[++i];
+            if (format != "csv" && format != "json")
+                return false;
+            options.json = (format == "json");
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--max-limbs") == 0)
+            options.maxLimbs = std::strtoull(argv[++i], nullptr, 10);
+        else if (i + 1 < argc && strcmp(argv[i], "--min-time") == 0)
+            options.minTime = std::strtod(argv[++i], nullptr);
+        else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0)
+            options.threads = static_cast<unsigned> (std::strtoul(argv[++i], nullptr, 10));
+        else
+            return false;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "użycie: " << argv[0]
+                  << " [--format csv|json] [--max-limbs N] [--min-time sekundy] [--threads N]\n";
+        return 2;
+    }
+    setThreadLimit(options.threads);
+
+    std::mt19937_64 gen(42);
+    std::vector<Result> results;
+    const double t = options.minTime;
+    for (std::size_t n = 1; n <= options.maxLimbs; n *= 10)
+    {
+        VeryLongInt a = randomNumber(n, gen);
+        VeryLongInt b = randomNumber(n, gen);
+        VeryLongInt wide = randomNumber(2 * n, gen);
+        //Różni się od a tylko najmłodszą cyfrą - porównanie musi przejrzeć całą liczbę
+        VeryLongInt aPlusOne = a + 1;
+        std::ostringstream decimal;
+        decimal << a;
+        const std::string text = decimal.str();
+
+        VeryLongInt sink;
+        volatile bool flag = false;
+        results.push_back(measure("parse", n, t, [&] { sink = VeryLongInt(text); }));
+        results.push_back(measure("print", n, t, [&] {
+            std::ostringstream out;
+            out << a;
+            flag = out.tellp() > 0;
+        }));
+        std::vector<char> chars(charsUpperBound(a));
+        results.push_back(measure("to_chars", n, t, [&] {
+            flag = toChars(chars.data(), chars.data() + chars.size(), a).ptr != chars.data();
+        }));
+        results.push_back(measure("from_chars", n, t, [&] {
+            flag = fromChars(text.data(), text.data() + text.size(), sink).ptr != text.data();
+        }));
+        results.push_back(measure("read_stream", n, t, [&] {
+            std::istringstream in(text);
+            in >> sink;
+        }));
+        std::vector<unsigned char> binary(binarySize(a));
+        results.push_back(measure("write_binary", n, t, [&] { flag = writeBinary(a, binary.data()) > 0; }));
+        results.push_back(measure("read_binary", n, t, [&] { flag = readBinary(binary.data(), binary.size(), sink) > 0; }));
+        const std::string hex = toString(a, 16);
+        results.push_back(measure("parse_hex", n, t, [&] { sink = fromString(hex, 16); }));
+        results.push_back(measure("print_hex", n, t, [&] { flag = toString(a, 16).size() > 0; }));
+        results.push_back(measure("add", n, t, [&] { sink = a + b; }));
+        results.push_back(measure("sub", n, t, [&] { sink = wide - a; }));
+        results.push_back(measure("mul", n, t, [&] { sink = a * b; }));
+        results.push_back(measure("add_1", n, t, [&] { sink = a + 1; }));
+        results.push_back(measure("mul_1", n, t, [&] { sink = a * 10; }));
+        results.push_back(measure("mod_1", n, t, [&] { sink = a % 7; }));
+        results.push_back(measure("sqr", n, t, [&] { sink = pow(a, 2); }));
+        results.push_back(measure("div", n, t, [&] { sink = wide / a; }));
+        results.push_back(measure("mod", n, t, [&] { sink = wide % a; }));
+        results.push_back(measure("isqrt", n, t, [&] { sink = isqrt(wide); }));
+        results.push_back(measure("gcd", n, t, [&] { sink = gcd(a, b); }));
+        results.push_back(measure("and", n, t, [&] { sink = a & b; }));
+        results.push_back(measure("or", n, t, [&] { sink = a | b; }));
+        results.push_back(measure("xor", n, t, [&] { sink = a ^ b; }));
+        results.push_back(measure("popcount", n, t, [&] { flag = a.popcount() > 0; }));
+        results.push_back(measure("bit_length", n, t, [&] { flag = a.numberOfBinaryDigits() > 0; }));
+        results.push_back(measure("shl", n, t, [&] { sink = a << 100; }));
+        results.push_back(measure("shr", n, t, [&] { sink = a >> 100; }));
+        //Porównania liczb różniących się tylko najmłodszą cyfrą: każdy operator
+        //powinien przejrzeć obie liczby raz (ns_per_limb to koszt odczytu pary cyfr)
+        results.push_back(measure("cmp", n, t, [&] { flag = a < aPlusOne; }));
+        results.push_back(measure("cmp_ge", n, t, [&] { flag = a >= aPlusOne; }));
+        //Równe liczby - równość też musi przejrzeć wszystkie cyfry
+        const VeryLongInt aCopy = a;
+        results.push_back(measure("cmp_eq", n, t, [&] { flag = a == aCopy; }));
+        //Operacje na n liczbach jednocyfrowych: iloczyn (drzewem) i n reszt liczby 2n-cyfrowej
+        if (n <= 100000)
+        {
+            std::vector<VeryLongInt> factors;
+            for (BaseType limb : randomLimbs(n, gen))
+                factors.push_back(VeryLongInt(limb | 1));
+            results.push_back(measure("product", n, t, [&] { sink = product(factors.data(), n); }));
+            results.push_back(measure("remainders", n, t, [&] {
+                flag = remainderTree(wide, factors.data(), n).size() == n;
+            }));
+        }
+        //Potęgowanie modularne z wykładnikiem długości modułu (np. RSA) - tylko dla
+        //rozmiarów, przy których pojedyncze wywołanie trwa rozsądnie krótko
+        if (n <= 100)
+        {
+            VeryLongInt oddModulus = wide >> (64 * n);
+            if (oddModulus % 2 == 0)
+                oddModulus += 1;
+            results.push_back(measure("powmod", n, t, [&] { sink = powmod(a, b, oddModulus); }));
+        }
+        (void) flag;
+    }
+
+    if (options.json)
+        printJson(results);
+    else
+        printCsv(results);
+    return 0;
+}
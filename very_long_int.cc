@@ -1,8 +1,13 @@
+#include <algorithm>
 #include <limits>
 #include <assert.h>
+#include <istream>
 #include <ostream>
 #include <string.h>
+#include <string_view>
+#include <utility>
 #include "very_long_int.h"
+#include "very_long_int_kernels.h"
 
 
 VeryLongInt::VeryLongInt(BaseType number)
@@ -11,23 +16,34 @@ VeryLongInt::VeryLongInt(BaseType number)
     isNaN = false;
 }
 
-VeryLongInt::VeryLongInt(const std::string& str) : VeryLongInt(str.c_str())
+VeryLongInt::VeryLongInt(const std::string& str)
 {
+    parseDecimal(str.data(), str.size());
 }
 
 VeryLongInt::VeryLongInt(const char* str)
 {
-    if (!validateString(str))
+    if (str == nullptr)
         isNaN = true;
     else
+        parseDecimal(str, strlen(str));
+}
+
+//Wczytuje zapis dziesiętny; poprawność znaków sprawdzana jest w trakcie konwersji,
+//a napis pusty lub zawierający coś poza cyframi daje NaN
+void VeryLongInt::parseDecimal(const char* str, std::size_t len)
+{
+    storage.resize(vlikernel::decimalLimbsUpperBound(len));
+    std::size_t n = vlikernel::fromDecimal(storage.data(), str, len);
+    if (n == 0)
     {
+        storage.clear();
+        isNaN = true;
+    }
+    else
+    {
+        storage.resize(n);
         isNaN = false;
-        storage.push_back(static_cast<BaseType> (0));
-        for (unsigned i = 0; str[i] != 0; i++)
-        {
-            operator*=(10);
-            operator+=(static_cast<BaseType> (str[i] - '0'));
-        }
     }
 }
 
@@ -55,20 +71,11 @@ unsigned long long VeryLongInt::numberOfBinaryDigits() const
 {
     if (isNaN)
         return 0;
-    if (operator==(*this, 0))
+    //Najstarsza cyfra jest niezerowa, chyba że liczba to 0 (zapisywane jedną cyfrą)
+    const BaseType last = storage.back();
+    if (last == 0)
         return 1;
-    else
-    {
-        auto noOfBits = std::numeric_limits<BaseType>::digits;
-        auto ret = (storage.size() - 1) * noOfBits;
-        BaseType last = storage.back();
-        while (last != 0)
-        {
-            ret++;
-            last >>= 1;
-        }
-        return ret;
-    }
+    return storage.size() * vlikernel::baseBits - vlikernel::countLeadingZeros(last);
 }
 
 //Usuwa wiodące cyfry zero ze storage (jeśli jakieś występują)
@@ -83,204 +90,208 @@ VeryLongInt& VeryLongInt::operator+=(const VeryLongInt& other)
 {
     if (isNaN || other.isNaN)
         return (operator=(NaN()));
-    // a - cyfra z tej liczby, b - cyfra z drugiej liczby
-    // r - cyfra będąca rezultatem, carry - cyfra do przeniesienia
-    BaseType a, b, r, carry = 0;
-
-    const std::size_t maxSize = std::max(storage.size(), other.storage.size());
-    storage.resize(maxSize + 1, 0);
-
-    for (std::size_t i = 0; i < maxSize + 1; i++)
-    {
-        a = storage[i];
-        b = (i < other.storage.size()) ? other.storage[i] : 0;
-        //Algorytm ten korzysta z arytmetyki modularnej typów unsigned, zatem jeśli
-        //a + b + carry przekraczają rozmiar BaseType, nadal otrzymamy poprawny wynik
-        r = a + b + carry;
-        //Jeśli cyfra będąca rezultatem jest mniejsza niż którakolwiek z wejściowych
-        //oznacza to, że powinno nastąpić przeniesienie.
-        if (carry == 0)
-            carry = (r < a || r < b) ? 1 : 0;
-        else
-            carry = (r <= a || r <= b) ? 1 : 0;
-        storage[i] = r;
-    }
 
-    truncate();
+    const std::size_t an = storage.size();
+    const std::size_t bn = other.storage.size();
+    BaseType carry;
+    if (an >= bn)
+    {
+        //Za krótszym argumentem przeniesienie zwykle wygasa po jednej cyfrze,
+        //a dalsze cyfry wyniku są już na swoim miejscu
+        carry = vlikernel::add(storage.data(), storage.data(), an,
+                               other.storage.data(), bn);
+    }
+    else
+    {
+        //other jest dłuższy, więc nie jest tym samym obiektem co *this
+        storage.resize(bn);
+        carry = vlikernel::add(storage.data(), other.storage.data(), bn,
+                               storage.data(), an);
+    }
+    //Argumenty nie mają wiodących zer, więc wynik też ich nie ma
+    if (carry != 0)
+        storage.push_back(carry);
     return *this;
 }
 
 VeryLongInt& VeryLongInt::operator-=(const VeryLongInt& other)
 {
-    if (isNaN || other.isNaN || operator<(*this, other))
-    {
+    if (isNaN || other.isNaN || storage.size() < other.storage.size())
         return (operator=(NaN()));
-    }
-    // a - cyfra z tej liczby, b - cyfra z drugiej liczby
-    // r - cyfra będąca rezultatem, borrow - cyfra do pożyczenia
-    BaseType a, b, r, borrow = 0;
 
-    const std::size_t maxSize = storage.size();
-    assert(storage.size() >= other.storage.size());
+    //Odejmowanie większej liczby od mniejszej kończy się pożyczką z najstarszej cyfry
+    BaseType borrow = vlikernel::sub(storage.data(), storage.data(), storage.size(),
+                                     other.storage.data(), other.storage.size());
+    if (borrow != 0)
+        return (operator=(NaN()));
+    return truncate();
+}
+
+VeryLongInt& VeryLongInt::operator*=(const VeryLongInt& other)
+{
+    return assignProduct(*this, other);
+}
+
+VeryLongInt& VeryLongInt::assignProduct(const VeryLongInt& a, const VeryLongInt& b)
+{
+    if (a.isNaN || b.isNaN)
+        return (operator=(NaN()));
 
-    for (std::size_t i = 0; i < maxSize; i++)
+    const std::size_t n = a.storage.size() + b.storage.size();
+    if (this == &a || this == &b)
     {
-        a = storage[i];
-        b = (i < other.storage.size()) ? other.storage[i] : 0;
-        //Algorytm ten korzysta z arytmetyki modularnej typów unsigned
-        //zatem jeśli a < b + borrow, to nadal dostajemy poprawny wynik
-        r = a - b - borrow;
-        //Jeśli cyfra od której odejmujemy jest większa niż odejmowana
-        //to powinno zajść pożyczenie
-        if (borrow == 0)
-            borrow = (a < b) ? 1 : 0;
-        else
-            borrow = (a <= b) ? 1 : 0;
-        storage[i] = r;
+        //Mnożenie nie może nadpisywać argumentów, więc wynik trafia do osobnego bufora
+        LimbStorage result;
+        result.resize(n);
+        vlikernel::mul(result.data(), a.storage.data(), a.storage.size(),
+                       b.storage.data(), b.storage.size());
+        storage.swap(result);
     }
-    assert(borrow == 0);
-
-    truncate();
-    return *this;
+    else
+    {
+        storage.resize(n);
+        vlikernel::mul(storage.data(), a.storage.data(), a.storage.size(),
+                       b.storage.data(), b.storage.size());
+        isNaN = false;
+    }
+    return truncate();
 }
 
-VeryLongInt& VeryLongInt::operator*=(const VeryLongInt& other)
+VeryLongInt& VeryLongInt::addProduct(const VeryLongInt& a, const VeryLongInt& b)
 {
-    if (isNaN || other.isNaN)
+    if (isNaN || a.isNaN || b.isNaN)
         return (operator=(NaN()));
-
-    //Z powodu sposobu działania algorytmu, jeśli *this i other to ten sam obiekt
-    //konieczne jest wykonanie kopii other
-    const VeryLongInt& other_non_arg = (this == &other) ? (VeryLongInt(other)) : (other);
-    VeryLongInt thisCopy = *this;
-    operator=(0);
-    auto noOfBits = std::numeric_limits<BaseType>::digits;
-    //Aby nie wykonywać niepotrzebnie pojedyńczych przesunięć na liczbach VeryLongInt
-    //zapamiętujemy liczbę przesunięć i wykonujemy je tylko, gdy potrzeba
-    int toShift = 0;
-
-    for (std::size_t i = 0; i < other_non_arg.storage.size(); i++)
-    {
-        //Obecnie przetwarzana cyfra drugiej liczby
-        BaseType b = other_non_arg.storage[i];
-        for (auto j = 0; j < noOfBits; j++)
+    if (this == &a || this == &b)
+        return operator+=(a * b);
+
+    const VeryLongInt& longer = a.storage.size() >= b.storage.size() ? a : b;
+    const VeryLongInt& shorter = a.storage.size() >= b.storage.size() ? b : a;
+    const BaseType* ap = longer.storage.data();
+    const BaseType* bp = shorter.storage.data();
+    const std::size_t an = longer.storage.size();
+    const std::size_t bn = shorter.storage.size();
+
+    //Jedna cyfra zapasu na przeniesienie z ostatniego dodawania
+    const std::size_t rn = std::max(storage.size(), an + bn) + 1;
+    storage.resize(rn);
+    BaseType* rp = storage.data();
+    if (bn < thresholds().karatsubaMul)
+    {
+        //Krótki argument: dodajemy kolejne wiersze mnożenia pisemnego wprost do wyniku
+        for (std::size_t i = 0; i < bn; i++)
         {
-            //Sprawdzamy kolejne bity. Jeśli bit jest równy 1,
-            //należy przesunąć kopię oryginalnej liczby i dodać ją
-            //do wyniku
-            if ((b & 1) == 1)
-            {
-                thisCopy <<= toShift;
-                toShift = 0;
-                operator+=(thisCopy);
-            }
-            b >>= 1;
-            toShift++;
+            BaseType carry = vlikernel::addMul1(rp + i, ap, an, bp[i]);
+            vlikernel::add1(rp + i + an, rp + i + an, rn - i - an, carry);
         }
     }
-    truncate();
-    return *this;
+    else
+    {
+        vlikernel::ScratchVector product(an + bn, limbResource());
+        vlikernel::mul(product.data(), ap, an, bp, bn);
+        vlikernel::add(rp, rp, rn, product.data(), an + bn);
+    }
+    return truncate();
 }
 
 //Funkcja wykonująca dzielenie, z której korzystają operatory /= i %=
-//Przyjmuje przez odniesienie dzielną i dzielnik oraz wskaźnik do zapisania reszty
-//(wskaźnik ten może być NULL, jeśli reszta z dzielenia nie jest potrzebna)
-VeryLongInt VeryLongInt::performDivision(const VeryLongInt& dividend_in,
-                                         const VeryLongInt& divisor_in,
-                                         VeryLongInt* remainder_out)
+//Zapisuje iloraz i resztę do obiektów wskazywanych przez quotient_out i remainder_out
+//(każdy z tych wskaźników może być NULL, jeśli dany wynik nie jest potrzebny).
+//Obiekty wynikowe mogą być tymi samymi obiektami co dzielna lub dzielnik.
+void VeryLongInt::performDivision(const VeryLongInt& dividend,
+                                  const VeryLongInt& divisor,
+                                  VeryLongInt* quotient_out,
+                                  VeryLongInt* remainder_out)
 {
-    auto noOfBits = std::numeric_limits<BaseType>::digits;
-    VeryLongInt quotient = 0;
-    if (dividend_in.isNaN || divisor_in.isNaN || divisor_in == 0)
+    if (dividend.isNaN || divisor.isNaN || divisor == 0)
     {
+        if (quotient_out != nullptr)
+            *quotient_out = NaN();
         if (remainder_out != nullptr)
             *remainder_out = NaN();
-        return (quotient = NaN());
+        return;
     }
 
-    if (divisor_in == 2)
-    {
-        if (remainder_out != nullptr)
-            *remainder_out = (dividend_in.storage[0] & (BaseType)1);
-        return (dividend_in >> 1);
-    }
+    const std::size_t an = dividend.storage.size();
+    const std::size_t dn = divisor.storage.size();
 
     //Dla uproszczenia osobno traktujemy przypadek, gdy dzielnik jest większy niż dzielna
-    if (divisor_in > dividend_in)
+    if (divisor > dividend)
     {
         if (remainder_out != nullptr)
-            *remainder_out = dividend_in;
-        return VeryLongInt();
+            *remainder_out = dividend;
+        if (quotient_out != nullptr)
+            *quotient_out = 0;
+        return;
     }
 
-    assert(dividend_in >= divisor_in);
+    assert(quotient_out == nullptr || quotient_out != remainder_out);
 
-    VeryLongInt dividend = dividend_in;
-    VeryLongInt divisor = divisor_in;
-
-    unsigned shift = 0;
-    
-    //Jeśli dzielnik jest znacząco większy od dzielnej, wykonujemy duże przesunięcie
-    //zamiast powtarzania pojedyńczych
-    if (divisor.storage.size() < dividend.storage.size() - 1){
-        shift = (dividend.storage.size() - divisor.storage.size() - 1) * noOfBits;
-        divisor <<= shift;
-    }
-
-    //Algorytm wykonuje binarne dzielenie pisemne liczb
-    //Przesuwamy dzielnik w lewo tak daleko, aż będzie 
-    //minimalnie mniejszy od dzielnej
-    while (divisor < dividend)
+    //Wyniki zapisywane są wprost do obiektów wynikowych (z użyciem ich buforów),
+    //chyba że pokrywają się one z argumentami - wtedy trafiają do buforów
+    //lokalnych i dopiero na końcu są przenoszone
+    LimbStorage quotientLocal, remainderLocal;
+    LimbStorage* quotient = nullptr;
+    if (quotient_out != nullptr)
     {
-        divisor <<= 1;
-        shift++;
+        bool aliased = (quotient_out == &dividend || quotient_out == &divisor);
+        quotient = aliased ? &quotientLocal : &quotient_out->storage;
     }
-
-    if (divisor > dividend)
+    LimbStorage* remainder = nullptr;
+    if (remainder_out != nullptr)
     {
-        divisor >>= 1;
-        shift--;
+        bool aliased = (remainder_out == &dividend || remainder_out == &divisor);
+        remainder = aliased ? &remainderLocal : &remainder_out->storage;
     }
 
-    //Dla poprawy prędkości odwlekamy przesuwanie ilorazu tak długo, jak to możliwe
-    unsigned quotientShift = 0;
-    for (unsigned i = 0; i <= shift; i++)
+    if (dn == 1)
     {
-        quotientShift++;
-        //Jeśli przesunięty dzielnik jest mniejszy lub równy dzielnej,
-        //należy go odjąć, a bitem ilorazu jest 1. Jeśli nie jest, bitem ilorazu jest 0.
-        //Bity 0 generowane są przez samo przesunięcie, bity 1 przez dodatkową operację bitowego OR
-        if (divisor <= dividend)
+        //Dzielnik jednocyfrowy - wystarczy jedno przejście dzieleniem 128/64
+        if (quotient != nullptr)
+            quotient->resize(an);
+        BaseType r = vlikernel::divRem1(quotient != nullptr ? quotient->data() : nullptr,
+                                        dividend.storage.data(), an, divisor.storage[0]);
+        if (remainder != nullptr)
         {
-            dividend -= divisor;
-            quotient <<= quotientShift;
-            quotientShift = 0;
-            quotient.storage.front() |= 1;
+            remainder->resize(1);
+            (*remainder)[0] = r;
         }
-        //W obu przypadkach przesuwamy dzielnik o jeden bit w lewo
-        divisor >>= 1;
     }
-    //wykonujemy "zaległe" przesunięcia
-    quotient <<= quotientShift;
+    else
+    {
+        if (quotient != nullptr)
+            quotient->resize(an - dn + 1);
+        if (remainder != nullptr)
+            remainder->resize(dn);
+        vlikernel::divRem(quotient != nullptr ? quotient->data() : nullptr,
+                          remainder != nullptr ? remainder->data() : nullptr,
+                          dividend.storage.data(), an, divisor.storage.data(), dn);
+    }
 
+    if (quotient_out != nullptr)
+    {
+        if (quotient == &quotientLocal)
+            quotient_out->storage.swap(quotientLocal);
+        quotient_out->isNaN = false;
+        quotient_out->truncate();
+    }
     if (remainder_out != nullptr)
     {
-        dividend.truncate();
-        *remainder_out = dividend;
+        if (remainder == &remainderLocal)
+            remainder_out->storage.swap(remainderLocal);
+        remainder_out->isNaN = false;
+        remainder_out->truncate();
     }
-
-    quotient.truncate();
-    return quotient;
 }
 
 VeryLongInt& VeryLongInt::operator/=(const VeryLongInt& other)
 {
-    return (operator=(performDivision(*this, other, nullptr)));
+    performDivision(*this, other, this, nullptr);
+    return *this;
 }
 
 VeryLongInt& VeryLongInt::operator%=(const VeryLongInt& other)
 {
-    performDivision(*this, other, this);
+    performDivision(*this, other, nullptr, this);
     return *this;
 }
 
@@ -288,35 +299,19 @@ VeryLongInt& VeryLongInt::operator>>=(unsigned long long i)
 {
     if (isNaN || i == 0 || operator==(*this, 0))
         return *this;
-    
-    auto noOfBits = std::numeric_limits<BaseType>::digits;
+
     //O ile cyfr przechowywanych w storage należy przesunąć bity
-    auto shiftMajor = i / noOfBits;
+    auto shiftMajor = i / vlikernel::baseBits;
     if (shiftMajor >= storage.size())
         return (operator=(0));
     //O ile bitów wewnątrz cyfry należy przesunąć bity
-    auto shiftMinor = i % noOfBits;
-    if (shiftMajor > 0)
-    {
-        for (std::size_t i = storage.size(); i > shiftMajor; i--)
-        {
-            storage[i - shiftMajor - 1] = storage[i - 1];
-            storage[i - 1] = 0;
-        }
-    }
-
+    unsigned shiftMinor = i % vlikernel::baseBits;
+    std::size_t n = storage.size() - shiftMajor;
     if (shiftMinor > 0)
-    {
-        //Przeniesienia bitów z poprzedniej cyfry do następnej
-        BaseType carryNew, carryOld = 0;
-        for (std::size_t i = storage.size(); i > 0; i--)
-        {
-            carryNew = storage[i - 1] << (noOfBits - shiftMinor);
-            storage[i - 1] = (storage[i - 1] >> shiftMinor) | carryOld;
-            carryOld = carryNew;
-        }
-        
-    }
+        vlikernel::rshift(storage.data(), storage.data() + shiftMajor, n, shiftMinor);
+    else
+        std::copy(storage.begin() + shiftMajor, storage.end(), storage.begin());
+    storage.resize(n);
     truncate();
     return *this;
 }
@@ -325,201 +320,781 @@ VeryLongInt& VeryLongInt::operator<<=(unsigned long long i)
 {
     if (isNaN || i == 0 || operator==(*this, 0))
         return *this;
-    
-    auto noOfBits = std::numeric_limits<BaseType>::digits;
+
     //O ile cyfr przechowywanych w storage należy przesunąć bity
-    auto shiftMajor = i / noOfBits;
+    auto shiftMajor = i / vlikernel::baseBits;
     //O ile bitów wewnątrz cyfry należy przesunąć bity
-    auto shiftMinor = i % noOfBits;
-    storage.resize(storage.size() + shiftMajor + 1, 0);
-    if (shiftMajor > 0)
-    {
-        for (std::size_t i = storage.size(); i > shiftMajor; i--)
-            storage[i - 1] = storage[i - shiftMajor - 1];
-        for (std::size_t i = shiftMajor; i > 0; i--)
-            storage[i - 1] = 0;
-    }
+    unsigned shiftMinor = i % vlikernel::baseBits;
+    std::size_t n = storage.size();
+    storage.resize(n + shiftMajor + 1);
+    //Przesuwamy od najstarszych cyfr, więc źródło nie jest nadpisywane przed odczytem
     if (shiftMinor > 0)
+        storage[n + shiftMajor] = vlikernel::lshift(storage.data() + shiftMajor, storage.data(), n, shiftMinor);
+    else
     {
-        //Przeniesienia bitów z poprzedniej cyfry do następnej
-        BaseType carryNew, carryOld = 0;
-        for (std::size_t i = 0; i < storage.size(); i++)
-        {
-            carryNew = storage[i] >> (noOfBits - shiftMinor);
-            storage[i] = (storage[i] << shiftMinor) | carryOld;
-            carryOld = carryNew;
-        }
+        std::copy_backward(storage.begin(), storage.begin() + n, storage.begin() + n + shiftMajor);
+        storage[n + shiftMajor] = 0;
     }
+    std::fill(storage.begin(), storage.begin() + shiftMajor, 0);
     truncate();
     return *this;
 }
 
-const VeryLongInt operator+(const VeryLongInt& lhs, const VeryLongInt& rhs)
+VeryLongInt operator+(const VeryLongInt& lhs, const VeryLongInt& rhs)
 {
-    return VeryLongInt(lhs) += rhs;
+    VeryLongInt result(lhs);
+    result += rhs;
+    return result;
 }
 
-const VeryLongInt operator-(const VeryLongInt& lhs, const VeryLongInt& rhs)
+VeryLongInt operator+(VeryLongInt&& lhs, const VeryLongInt& rhs)
 {
-    return VeryLongInt(lhs) -= rhs;
+    lhs += rhs;
+    return std::move(lhs);
 }
 
-const VeryLongInt operator*(const VeryLongInt& lhs, const VeryLongInt& rhs)
+//Dodawanie jest przemienne, więc wynik można policzyć w buforze prawego argumentu
+VeryLongInt operator+(const VeryLongInt& lhs, VeryLongInt&& rhs)
 {
-    return VeryLongInt(lhs) *= rhs;
+    rhs += lhs;
+    return std::move(rhs);
 }
 
-const VeryLongInt operator/(const VeryLongInt& lhs, const VeryLongInt& rhs)
+VeryLongInt operator+(VeryLongInt&& lhs, VeryLongInt&& rhs)
 {
-    return VeryLongInt(lhs) /= rhs;
+    lhs += rhs;
+    return std::move(lhs);
 }
 
-const VeryLongInt operator%(const VeryLongInt& lhs, const VeryLongInt& rhs)
+VeryLongInt operator-(const VeryLongInt& lhs, const VeryLongInt& rhs)
 {
-    return VeryLongInt(lhs) %= rhs;
+    VeryLongInt result(lhs);
+    result -= rhs;
+    return result;
 }
 
-const VeryLongInt operator>>(const VeryLongInt& lhs, unsigned long long i)
+VeryLongInt operator-(VeryLongInt&& lhs, const VeryLongInt& rhs)
 {
-    return VeryLongInt(lhs) >>= i;
+    lhs -= rhs;
+    return std::move(lhs);
 }
 
-const VeryLongInt operator<<(const VeryLongInt& lhs, unsigned long long i)
+//Iloczyn i iloraz i tak powstają w nowym buforze, więc nie kopiujemy lewego argumentu
+VeryLongInt operator*(const VeryLongInt& lhs, const VeryLongInt& rhs)
 {
-    return VeryLongInt(lhs) <<= i;
+    VeryLongInt result;
+    result.assignProduct(lhs, rhs);
+    return result;
 }
 
-bool operator==(const VeryLongInt& lhs, const VeryLongInt& rhs)
+VeryLongInt operator/(const VeryLongInt& lhs, const VeryLongInt& rhs)
 {
-    if (!lhs.isValid() || !rhs.isValid())
-        return false;
-    if (lhs.storage.size() == rhs.storage.size())
+    VeryLongInt result;
+    VeryLongInt::performDivision(lhs, rhs, &result, nullptr);
+    return result;
+}
+
+VeryLongInt operator%(const VeryLongInt& lhs, const VeryLongInt& rhs)
+{
+    VeryLongInt result;
+    VeryLongInt::performDivision(lhs, rhs, nullptr, &result);
+    return result;
+}
+
+VeryLongIntDivision divmod(const VeryLongInt& dividend, const VeryLongInt& divisor)
+{
+    VeryLongIntDivision result;
+    divmod(dividend, divisor, result.quotient, result.remainder);
+    return result;
+}
+
+void divmod(const VeryLongInt& dividend, const VeryLongInt& divisor,
+            VeryLongInt& quotient, VeryLongInt& remainder)
+{
+    VeryLongInt::performDivision(dividend, divisor, &quotient, &remainder);
+}
+
+BaseType divmod(const VeryLongInt& dividend, BaseType divisor, VeryLongInt& quotient)
+{
+    if (dividend.isNaN || divisor == 0)
     {
-        for (size_t i = 0; i < lhs.storage.size(); i++)
-            if (lhs.storage[i] != rhs.storage[i])
-                return false;
-        return true;
+        quotient = NaN();
+        return 0;
     }
-    return false;
+    //divRem1 może dzielić w miejscu, więc quotient może być tym samym obiektem co dividend
+    const std::size_t n = dividend.storage.size();
+    quotient.storage.resize(n);
+    BaseType r = vlikernel::divRem1(quotient.storage.data(), dividend.storage.data(), n, divisor);
+    quotient.isNaN = false;
+    quotient.truncate();
+    return r;
 }
 
-bool operator!=(const VeryLongInt& lhs, const VeryLongInt& rhs)
+void vliscalar::Ops::add(VeryLongInt& x, BaseType b)
 {
-    if (!lhs.isValid() || !rhs.isValid())
-        return false;
-    return !(lhs == rhs);
+    if (x.isNaN)
+        return;
+    const BaseType carry = vlikernel::add1(x.storage.data(), x.storage.data(), x.storage.size(), b);
+    if (carry != 0)
+        x.storage.push_back(carry);
 }
 
-bool operator<=(const VeryLongInt& lhs, const VeryLongInt& rhs)
+void vliscalar::Ops::sub(VeryLongInt& x, BaseType b)
 {
-    if (!lhs.isValid() || !rhs.isValid())
-        return false;
+    if (x.isNaN)
+        return;
+    if (vlikernel::sub1(x.storage.data(), x.storage.data(), x.storage.size(), b) != 0)
+        x = NaN();
+    else
+        x.truncate();
+}
 
-    if (lhs.storage.size() == rhs.storage.size())
+void vliscalar::Ops::mul(VeryLongInt& x, BaseType b)
+{
+    if (x.isNaN)
+        return;
+    const BaseType carry = vlikernel::mul1(x.storage.data(), x.storage.data(), x.storage.size(), b);
+    if (carry != 0)
+        x.storage.push_back(carry);
+    else
+        x.truncate(); //mnożenie przez 0
+}
+
+void vliscalar::Ops::div(VeryLongInt& x, BaseType b)
+{
+    if (x.isNaN || b == 0)
     {
-        for (std::size_t i = lhs.storage.size(); i > 0; i--)
+        x = NaN();
+        return;
+    }
+    vlikernel::divRem1(x.storage.data(), x.storage.data(), x.storage.size(), b);
+    x.truncate();
+}
+
+void vliscalar::Ops::mod(VeryLongInt& x, BaseType b)
+{
+    if (x.isNaN || b == 0)
+    {
+        x = NaN();
+        return;
+    }
+    const BaseType r = vlikernel::divRem1(nullptr, x.storage.data(), x.storage.size(), b);
+    x.storage.resize(1);
+    x.storage[0] = r;
+}
+
+//Wyniki poniższych działań powstają od razu w nowej liczbie, bez kopii argumentu.
+//Cyfra przeniesienia dopisywana jest tylko wtedy, gdy jest niezerowa, więc krótkie
+//wyniki pozostają w buforze wewnętrznym; bufor na stercie ma od razu miejsce na nią.
+
+VeryLongInt vliscalar::Ops::sum(const VeryLongInt& a, BaseType b)
+{
+    if (a.isNaN)
+        return NaN();
+    const std::size_t n = a.storage.size();
+    VeryLongInt result;
+    if (n > LimbStorage::inlineCapacity)
+        result.storage.reserve(n + 1);
+    result.storage.resize(n);
+    const BaseType carry = vlikernel::add1(result.storage.data(), a.storage.data(), n, b);
+    if (carry != 0)
+        result.storage.push_back(carry);
+    return result;
+}
+
+VeryLongInt vliscalar::Ops::difference(const VeryLongInt& a, BaseType b)
+{
+    if (a.isNaN)
+        return NaN();
+    const std::size_t n = a.storage.size();
+    VeryLongInt result;
+    result.storage.resize(n);
+    if (vlikernel::sub1(result.storage.data(), a.storage.data(), n, b) != 0)
+        return NaN();
+    result.truncate();
+    return result;
+}
+
+VeryLongInt vliscalar::Ops::product(const VeryLongInt& a, BaseType b)
+{
+    if (a.isNaN)
+        return NaN();
+    const std::size_t n = a.storage.size();
+    VeryLongInt result;
+    if (n > LimbStorage::inlineCapacity)
+        result.storage.reserve(n + 1);
+    result.storage.resize(n);
+    const BaseType carry = vlikernel::mul1(result.storage.data(), a.storage.data(), n, b);
+    if (carry != 0)
+        result.storage.push_back(carry);
+    else
+        result.truncate(); //mnożenie przez 0
+    return result;
+}
+
+VeryLongInt vliscalar::Ops::quotient(const VeryLongInt& a, BaseType b)
+{
+    if (a.isNaN || b == 0)
+        return NaN();
+    const std::size_t n = a.storage.size();
+    VeryLongInt result;
+    result.storage.resize(n);
+    vlikernel::divRem1(result.storage.data(), a.storage.data(), n, b);
+    result.truncate();
+    return result;
+}
+
+VeryLongInt vliscalar::Ops::remainder(const VeryLongInt& a, BaseType b)
+{
+    if (a.isNaN || b == 0)
+        return NaN();
+    return vlikernel::divRem1(nullptr, a.storage.data(), a.storage.size(), b);
+}
+
+int vliscalar::Ops::compare(const VeryLongInt& a, BaseType b)
+{
+    //Liczba bez wiodących zer, która ma więcej niż jedną cyfrę, jest większa od każdej cyfry
+    if (a.storage.size() > 1)
+        return 1;
+    return a.storage[0] < b ? -1 : (a.storage[0] > b ? 1 : 0);
+}
+
+VeryLongIntDivisor::VeryLongIntDivisor(const VeryLongInt& divisor)
+    : divisor(divisor), shift(0), reciprocal(0)
+{
+    if (!divisor.isValid() || divisor == 0)
+    {
+        this->divisor = NaN();
+        return;
+    }
+    const std::size_t n = divisor.storage.size();
+    shift = vlikernel::countLeadingZeros(divisor.storage[n - 1]);
+    normalized.resize(n);
+    if (shift > 0)
+        vlikernel::lshift(normalized.data(), divisor.storage.data(), n, shift);
+    else
+        std::copy(divisor.storage.begin(), divisor.storage.end(), normalized.begin());
+    if (n == 1)
+        reciprocal = vlikernel::reciprocal2by1(normalized[0]);
+    else
+        reciprocal = vlikernel::reciprocal3by2(normalized[n - 1], normalized[n - 2]);
+}
+
+bool VeryLongIntDivisor::isValid() const
+{
+    return divisor.isValid();
+}
+
+const VeryLongInt& VeryLongIntDivisor::value() const
+{
+    return divisor;
+}
+
+VeryLongInt VeryLongIntDivisor::div(const VeryLongInt& dividend) const
+{
+    VeryLongInt result;
+    divide(dividend, &result, nullptr);
+    return result;
+}
+
+VeryLongInt VeryLongIntDivisor::mod(const VeryLongInt& dividend) const
+{
+    VeryLongInt result;
+    divide(dividend, nullptr, &result);
+    return result;
+}
+
+VeryLongIntDivision VeryLongIntDivisor::divmod(const VeryLongInt& dividend) const
+{
+    VeryLongIntDivision result;
+    divide(dividend, &result.quotient, &result.remainder);
+    return result;
+}
+
+void VeryLongIntDivisor::divmod(const VeryLongInt& dividend, VeryLongInt& quotient, VeryLongInt& remainder) const
+{
+    divide(dividend, &quotient, &remainder);
+}
+
+void VeryLongIntDivisor::divide(const VeryLongInt& dividend,
+                                VeryLongInt* quotient_out,
+                                VeryLongInt* remainder_out) const
+{
+    if (!isValid() || dividend.isNaN)
+    {
+        if (quotient_out != nullptr)
+            *quotient_out = NaN();
+        if (remainder_out != nullptr)
+            *remainder_out = NaN();
+        return;
+    }
+    if (divisor > dividend)
+    {
+        if (remainder_out != nullptr)
+            *remainder_out = dividend;
+        if (quotient_out != nullptr)
+            *quotient_out = 0;
+        return;
+    }
+
+    assert(quotient_out == nullptr || quotient_out != remainder_out);
+
+    //Jądra dzielenia czytają dzielną przed zapisaniem wyników (lub kopiują ją na początku),
+    //a wyniki są nie dłuższe od dzielnej, więc mogą trafić wprost do jej bufora
+    const std::size_t an = dividend.storage.size();
+    const std::size_t dn = normalized.size();
+    const BaseType* ap = dividend.storage.data();
+    BaseType* qp = nullptr;
+    if (quotient_out != nullptr)
+    {
+        quotient_out->storage.resize(an - dn + 1);
+        qp = quotient_out->storage.data();
+    }
+
+    if (dn == 1)
+    {
+        BaseType r = vlikernel::divRem1Preinv(qp, ap, an, normalized[0], shift, reciprocal);
+        if (remainder_out != nullptr)
         {
-            if (lhs.storage[i - 1] != rhs.storage[i - 1])
-                return (lhs.storage[i - 1] < rhs.storage[i - 1]);
+            remainder_out->storage.resize(1);
+            remainder_out->storage[0] = r;
         }
-        return true; //Liczby są równe
     }
     else
-        return (lhs.storage.size() < rhs.storage.size());
+    {
+        BaseType* rp = nullptr;
+        if (remainder_out != nullptr)
+        {
+            remainder_out->storage.resize(dn);
+            rp = remainder_out->storage.data();
+        }
+        vlikernel::divRemNormalized(qp, rp, ap, an, normalized.data(), dn, shift, reciprocal);
+    }
+
+    if (quotient_out != nullptr)
+    {
+        quotient_out->isNaN = false;
+        quotient_out->truncate();
+    }
+    if (remainder_out != nullptr)
+    {
+        remainder_out->isNaN = false;
+        remainder_out->truncate();
+    }
 }
 
-bool operator>=(const VeryLongInt& lhs, const VeryLongInt& rhs)
+VeryLongInt operator/(const VeryLongInt& lhs, const VeryLongIntDivisor& rhs)
+{
+    return rhs.div(lhs);
+}
+
+VeryLongInt operator%(const VeryLongInt& lhs, const VeryLongIntDivisor& rhs)
+{
+    return rhs.mod(lhs);
+}
+
+VeryLongInt operator>>(const VeryLongInt& lhs, unsigned long long i)
+{
+    VeryLongInt result(lhs);
+    result >>= i;
+    return result;
+}
+
+VeryLongInt operator>>(VeryLongInt&& lhs, unsigned long long i)
+{
+    lhs >>= i;
+    return std::move(lhs);
+}
+
+VeryLongInt operator<<(const VeryLongInt& lhs, unsigned long long i)
+{
+    VeryLongInt result(lhs);
+    result <<= i;
+    return result;
+}
+
+VeryLongInt operator<<(VeryLongInt&& lhs, unsigned long long i)
+{
+    lhs <<= i;
+    return std::move(lhs);
+}
+
+VeryLongIntOrdering compare(const VeryLongInt& lhs, const VeryLongInt& rhs)
+{
+    if (lhs.isNaN || rhs.isNaN)
+        return VeryLongIntOrdering::unordered;
+    //Liczby nie mają wiodących zer, więc dłuższa jest większa; równej długości
+    //porównujemy od najstarszej cyfry do pierwszej różnej
+    const std::size_t n = lhs.storage.size();
+    int order;
+    if (n != rhs.storage.size())
+        order = n < rhs.storage.size() ? -1 : 1;
+    else
+        order = vlikernel::compareN(lhs.storage.data(), rhs.storage.data(), n);
+    return order < 0 ? VeryLongIntOrdering::less
+                     : (order > 0 ? VeryLongIntOrdering::greater : VeryLongIntOrdering::equal);
+}
+
+//Równość nie wymaga kolejności cyfr: najpierw najmłodsza cyfra (bez wywołania
+//memcmp dla liczb jednocyfrowych), potem reszta bufora naraz
+bool operator==(const VeryLongInt& lhs, const VeryLongInt& rhs)
 {
     if (!lhs.isValid() || !rhs.isValid())
         return false;
-    return !(lhs <= rhs) || lhs == rhs;
+    return lhs.storage.size() == rhs.storage.size() && lhs.storage[0] == rhs.storage[0]
+        && std::equal(lhs.storage.begin() + 1, lhs.storage.end(), rhs.storage.begin() + 1);
 }
 
-bool operator<(const VeryLongInt& lhs, const VeryLongInt& rhs)
+bool operator!=(const VeryLongInt& lhs, const VeryLongInt& rhs)
 {
     if (!lhs.isValid() || !rhs.isValid())
         return false;
-    return lhs <= rhs && lhs != rhs;
+    return !(lhs == rhs);
+}
+
+//Pozostałe porównania przeglądają cyfry raz, przez compare (z NaN są fałszywe)
+bool operator<=(const VeryLongInt& lhs, const VeryLongInt& rhs)
+{
+    const VeryLongIntOrdering order = compare(lhs, rhs);
+    return order == VeryLongIntOrdering::less || order == VeryLongIntOrdering::equal;
+}
+
+bool operator>=(const VeryLongInt& lhs, const VeryLongInt& rhs)
+{
+    const VeryLongIntOrdering order = compare(lhs, rhs);
+    return order == VeryLongIntOrdering::greater || order == VeryLongIntOrdering::equal;
+}
+
+bool operator<(const VeryLongInt& lhs, const VeryLongInt& rhs)
+{
+    return compare(lhs, rhs) == VeryLongIntOrdering::less;
 }
 
 bool operator>(const VeryLongInt& lhs, const VeryLongInt& rhs)
 {
-    if (!lhs.isValid() || !rhs.isValid())
-        return false;
-    return !(lhs <= rhs);
+    return compare(lhs, rhs) == VeryLongIntOrdering::greater;
 }
 
+namespace
+{
 
-std::ostream& operator<<(std::ostream& out, const VeryLongInt& obj)
+//log2(base) dla podstawy będącej potęgą dwójki od 2 do 32, w przeciwnym razie 0
+unsigned radixBits(unsigned base)
 {
-    if (obj.isNaN)
+    if (base < 2 || base > 32 || (base & (base - 1)) != 0)
+        return 0;
+    return __builtin_ctz(base);
+}
+
+bool supportedBase(unsigned base)
+{
+    return base == 10 || radixBits(base) != 0;
+}
+
+//Podstawa wybrana flagami strumienia; 0, gdy żadna flaga systemu nie jest ustawiona
+unsigned streamBase(const std::ios_base& stream)
+{
+    switch (stream.flags() & std::ios_base::basefield)
     {
-        out << "NaN";
-        return out;
+    case std::ios_base::hex:
+        return 16;
+    case std::ios_base::oct:
+        return 8;
+    case std::ios_base::dec:
+        return 10;
+    default:
+        return 0;
     }
+}
+
+//Czy c jest cyfrą systemu o podstawie base (do 36)
+bool isDigit(int c, unsigned base)
+{
+    int value = vlikernel::digitValue(static_cast<char> (c));
+    return c != std::char_traits<char>::eof() && value >= 0 && static_cast<unsigned> (value) < base;
+}
+
+//Bloki cyfr, z których operator>> składa wczytywaną liczbę, mają 19 * 2^blockLevel
+//cyfr - dla zapisu dziesiętnego ich łączenie korzysta ze wspólnej tablicy potęg 10^(19 * 2^k)
+const unsigned blockLevel = 6;
+const std::size_t blockDigits = 19 << blockLevel;
+
+/**
+ * Składa liczbę z kolejnych bloków cyfr bez przechowywania całego zapisu.
+ * Części łączone są jak w liczniku dwójkowym: dwie ostatnie części tej samej
+ * długości zastępuje ich złączenie, więc mnożone są liczby podobnej długości,
+ * a koszt całości jest rzędu M(n) log n, jak przy wczytywaniu napisu.
+ */
+class DigitAccumulator
+{
+public:
+    explicit DigitAccumulator(unsigned base) : base(base), bits(radixBits(base)) {}
 
-    //Dla uproszczenia zero traktujemy osobno
-    if (obj == 0)
+    //Dopisuje blockDigits cyfr, młodszych od dotychczasowych
+    void append(const char* digits)
     {
-        out << "0";
-        return out;
+        parts.emplace_back();
+        fromChars(digits, digits + blockDigits, parts.back().value, base);
+        while (parts.size() >= 2 && parts[parts.size() - 2].level == parts.back().level)
+        {
+            Part& high = parts[parts.size() - 2];
+            join(high.value, parts.back().value, blockDigits << high.level);
+            high.level++;
+            parts.pop_back();
+        }
     }
-    /*
-        Kod wykorzystuje algorytm double dabble do konwersji
-        ciągu binarnego na BCD (binary coded decimal)
-        http://en.wikipedia.org/wiki/Double_dabble
-    */
-    auto noOfBits = std::numeric_limits<BaseType>::digits;
-    auto decLength = (obj.storage.size() * noOfBits + 2) / 3;
-    char* dec = new char[decLength + 1]; //Tablica przechowująca cyfry dziesiętne
-    for (unsigned i = 0; i < decLength + 1; i++)
-        dec[i] = 0;
-    unsigned firstDigit = decLength - 2;
 
-    for (int i = obj.numberOfBinaryDigits() - 1; i >= 0; i--)
+    //Liczba złożona z dotychczasowych bloków i ostatnich count < blockDigits cyfr
+    VeryLongInt finish(const char* digits, std::size_t count)
     {
-        //Wczytaj nowy bit z liczby wejściowej. Rzutowanie 1 na BaseType jest bardzo ważne
-        unsigned newBit = (obj.storage[i / noOfBits] & ((BaseType) 1 << (i % noOfBits))) ? 1 : 0;
-        //Dodaj 3 do każdej cyfry większej lub równej niż 5
-        for (unsigned k = firstDigit; k < decLength; k++)
-            if (dec[k] >= 5)
-                dec[k] += 3;
+        VeryLongInt result;
+        for (std::size_t i = 0; i < parts.size(); i++)
+        {
+            if (i == 0)
+                result = std::move(parts[0].value);
+            else
+                join(result, parts[i].value, blockDigits << parts[i].level);
+        }
+        if (count > 0)
+        {
+            VeryLongInt tail;
+            fromChars(digits, digits + count, tail, base);
+            if (parts.empty())
+                result = std::move(tail);
+            else
+                join(result, tail, count);
+        }
+        return result;
+    }
 
-        //Zwiększ liczbę cyfr, jeśli potrzeba
-        if (dec[firstDigit] >= 8)
-            firstDigit--;
+private:
+    struct Part
+    {
+        VeryLongInt value;
+        unsigned level = 0; //część ma blockDigits * 2^level cyfr
+    };
 
-        //Cyfry poza ostatnią
-        for (unsigned k = firstDigit; k < decLength - 1; k++)
+    //high = high * base^count + low
+    void join(VeryLongInt& high, const VeryLongInt& low, std::size_t count) const
+    {
+        if (bits != 0)
+            high <<= static_cast<unsigned long long> (bits) * count;
+        else if (count % blockDigits == 0 && ((count / blockDigits) & (count / blockDigits - 1)) == 0)
         {
-            dec[k] <<= 1; //Przesuń o 1 bit do przodu
-            dec[k] &= 0xF; //Usuń nadmiarowe bity
-            dec[k] |= (dec[k + 1] >= 8); //Dodaj na koniec ostatni bit następnej cyfry
+            const std::vector<BaseType>& power =
+                vlikernel::decimalPower(blockLevel + __builtin_ctzll(count / blockDigits));
+            high *= VeryLongIntView(power.data(), power.size());
         }
-        //Ostatnia cyfra
-        dec[decLength - 1] <<= 1; //Przesuń o 1 bit do przodu
-        dec[decLength - 1] &= 0xF; //Usuń nadmiarowe bity
-        dec[decLength - 1] |= newBit; //Dodaj na koniec bit wczytany z liczby wejściowej
+        else
+            high *= pow(VeryLongInt(10), count);
+        high += low;
     }
 
-    //Przekonwertuj z BCD na ASCII
-    for (unsigned i = 0; i < decLength; i++)
-        dec[i] += '0';
+    std::vector<Part> parts;
+    unsigned base;
+    unsigned bits;
+};
+
+}
+
+std::size_t charsUpperBound(const VeryLongInt& x, unsigned base)
+{
+    if (!supportedBase(base))
+        return 0;
+    if (x.isNaN)
+        return 3;
+    const BaseType* ap = x.storage.data();
+    const std::size_t n = x.storage.size();
+    return base == 10 ? vlikernel::decimalDigitsUpperBound(ap, n) : vlikernel::radixDigits(ap, n, radixBits(base));
+}
 
-    //Usuń wiodące zera
-    char* dec_trim = dec;
-    while (*dec_trim == '0')
+std::to_chars_result toChars(char* first, char* last, const VeryLongInt& x, unsigned base, bool uppercase)
+{
+    const std::size_t bound = charsUpperBound(x, base);
+    const std::size_t space = static_cast<std::size_t> (last - first);
+    if (bound == 0)
+        return {first, std::errc::invalid_argument};
+    if (x.isNaN)
     {
-        dec_trim++;
+        if (space < 3)
+            return {last, std::errc::value_too_large};
+        return {std::copy_n("NaN", 3, first), std::errc()};
     }
+
+    const BaseType* ap = x.storage.data();
+    const std::size_t n = x.storage.size();
+    if (base != 10)
+    {
+        //Długość zapisu w systemie o podstawie 2^bits jest znana dokładnie
+        if (space < bound)
+            return {last, std::errc::value_too_large};
+        return {first + vlikernel::toRadix(first, ap, n, radixBits(base), uppercase), std::errc()};
+    }
+    if (space >= bound)
+        return {first + vlikernel::toDecimal(first, ap, n), std::errc()};
+
+    //Oszacowanie długości zapisu dziesiętnego może przekraczać ją o jedną cyfrę,
+    //więc bufor krótszy od niego wciąż może wystarczyć - zapis powstaje wtedy obok
+    std::string digits(bound, '0');
+    const std::size_t count = vlikernel::toDecimal(&digits[0], ap, n);
+    if (count > space)
+        return {last, std::errc::value_too_large};
+    return {std::copy_n(digits.data(), count, first), std::errc()};
+}
+
+std::from_chars_result fromChars(const char* first, const char* last, VeryLongInt& x, unsigned base)
+{
+    const std::size_t len = static_cast<std::size_t> (last - first);
+    if (len >= 3 && std::equal(first, first + 3, "NaN"))
+    {
+        x = NaN();
+        return {first + 3, std::errc()};
+    }
+    const std::size_t count = supportedBase(base) ? vlikernel::digitSpan(first, len, base) : 0;
+    if (count == 0)
+        return {first, std::errc::invalid_argument};
+
+    //Cyfry trafiają wprost do bufora x
+    const unsigned bits = radixBits(base);
+    x.storage.resize(bits == 0 ? vlikernel::decimalLimbsUpperBound(count) : vlikernel::radixLimbsUpperBound(count, bits));
+    const std::size_t n = bits == 0 ? vlikernel::fromDecimal(x.storage.data(), first, count)
+                                    : vlikernel::fromRadix(x.storage.data(), first, count, bits);
+    x.storage.resize(n);
+    x.isNaN = false;
+    return {first + count, std::errc()};
+}
+
+std::string toString(const VeryLongInt& x, unsigned base, bool uppercase)
+{
+    std::string result(charsUpperBound(x, base), '0');
+    char* first = &result[0];
+    result.resize(toChars(first, first + result.size(), x, base, uppercase).ptr - first);
+    return result;
+}
+
+VeryLongInt fromString(const std::string& str, unsigned base)
+{
+    VeryLongInt result;
+    const std::from_chars_result parsed = fromChars(str.data(), str.data() + str.size(), result, base);
+    if (parsed.ec != std::errc() || parsed.ptr != str.data() + str.size())
+        return NaN();
+    return result;
+}
+
+std::ostream& operator<<(std::ostream& out, const VeryLongInt& obj)
+{
+    const unsigned base = streamBase(out) == 0 ? 10 : streamBase(out);
+    const bool uppercase = (out.flags() & std::ios_base::uppercase) != 0;
+
+    //Krótkie zapisy powstają w buforze na stosie, bez alokacji; 2 znaki na przedrostek
+    char local[256];
+    std::string large;
+    const std::size_t size = 2 + charsUpperBound(obj, base);
+    char* first = local;
+    if (size > sizeof(local))
+    {
+        large.resize(size);
+        first = &large[0];
+    }
+    char* last = first;
+    //Przedrostek jak dla typów wbudowanych: 0x dla szesnastkowego, 0 dla ósemkowego (poza zerem)
+    if ((out.flags() & std::ios_base::showbase) != 0 && base != 10 && obj)
+    {
+        if (base == 16)
+        {
+            *last++ = '0';
+            *last++ = uppercase ? 'X' : 'x';
+        }
+        else
+            *last++ = '0';
+    }
+    last = toChars(last, first + size, obj, base, uppercase).ptr;
     //Nie tworzymy obiektu tymczasowego, ponieważ out jest przekazany przez referencję
     //i zwracana jest referencja do obiektu out
-    out << dec_trim;
-    delete[] dec;
-
+    out << std::string_view(first, last - first);
     return out;
 }
 
+std::istream& operator>>(std::istream& in, VeryLongInt& obj)
+{
+    //sentry pomija białe znaki (o ile nie wyłączono std::skipws)
+    std::istream::sentry sentry(in);
+    if (!sentry)
+    {
+        obj = NaN();
+        return in;
+    }
+
+    //Znaki pobierane są wprost z bufora strumienia
+    std::streambuf* buffer = in.rdbuf();
+    const std::istream::int_type eof = std::char_traits<char>::eof();
+    std::istream::int_type c = buffer->sgetc();
+    if (c == 'N')
+    {
+        //Zapis nieliczby, taki jak wypisuje operator<<
+        const char* rest = "NaN";
+        while (*rest != '\0' && c == *rest)
+        {
+            rest++;
+            c = buffer->snextc();
+        }
+        if (*rest != '\0')
+            in.setstate(std::ios_base::failbit);
+        if (c == eof)
+            in.setstate(std::ios_base::eofbit);
+        obj = NaN();
+        return in;
+    }
+
+    //Cyfry zbierane są w blokach o stałej długości, składanych od razu w liczbę,
+    //więc pamięć zajmuje tylko wynik, a nie cały zapis
+    unsigned base = streamBase(in);
+    char block[blockDigits];
+    std::size_t count = 0;
+    bool any = false;
+    if ((base == 16 || base == 0) && c == '0')
+    {
+        //Przedrostek 0x (szesnastkowy) lub 0 (ósemkowy, przy rozpoznawaniu systemu)
+        c = buffer->snextc();
+        if (c == 'x' || c == 'X')
+        {
+            c = buffer->snextc();
+            base = 16;
+        }
+        else
+        {
+            block[count++] = '0';
+            any = true;
+            if (base == 0)
+                base = 8;
+        }
+    }
+    if (base == 0)
+        base = 10;
+
+    DigitAccumulator accumulator(base);
+    for (; isDigit(c, base); c = buffer->snextc())
+    {
+        block[count++] = static_cast<char> (c);
+        any = true;
+        if (count == blockDigits)
+        {
+            accumulator.append(block);
+            count = 0;
+        }
+    }
+    if (c == eof)
+        in.setstate(std::ios_base::eofbit);
+
+    if (!any)
+    {
+        in.setstate(std::ios_base::failbit);
+        obj = NaN();
+        return in;
+    }
+    obj = accumulator.finish(block, count);
+    return in;
+}
 
 VeryLongInt::operator bool() const
 {
@@ -535,6 +1110,26 @@ bool VeryLongInt::isValid() const
     return !isNaN;
 }
 
+namespace
+{
+VeryLongIntThresholds currentThresholds;
+}
+
+const VeryLongIntThresholds& thresholds()
+{
+    return currentThresholds;
+}
+
+void setThresholds(const VeryLongIntThresholds& value)
+{
+    currentThresholds = value;
+}
+
+void releaseScratchMemory()
+{
+    vlikernel::releaseNttScratch();
+}
+
 const VeryLongInt& Zero()
 {
     static const VeryLongInt zero;
@@ -546,19 +1141,3 @@ const VeryLongInt& NaN()
     static const VeryLongInt nan("");
     return nan;
 }
-
-bool VeryLongInt::validateString(const char* str) const
-{
-    if(str == nullptr)
-        return false;
-    size_t len = strlen(str);
-    if (len == 0)
-            return false;
-
-    for (size_t i = 0; str[i] != 0; i++)
-        if (!isdigit(str[i]))
-        {
-            return false;
-        }
-    return true;
-}
@@ -1,5 +1,16 @@
-#include <vector>
+#ifndef VERY_LONG_INT_H
+#define VERY_LONG_INT_H
+
+#include <charconv>
+#if defined(__cpp_impl_three_way_comparison)
+#include <compare>
+#endif
+#include <iosfwd>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "very_long_int_storage.h"
 
 /** ROZLICZENIE:
 
@@ -71,9 +82,83 @@
  */
 
 
-typedef unsigned long long BaseType;
-
 class VeryLongInt;
+class VeryLongIntView;
+enum class VeryLongIntOrdering;
+enum class VeryLongIntByteOrder;
+struct VeryLongIntBezout;
+
+namespace vliexpr
+{
+struct Evaluator;
+}
+
+/**
+ * Działania z wbudowaną liczbą całkowitą (np. x * 10, x + 1, x % 7, x == 0) wykonywane
+ * są wprost na cyfrach x procedurami dla jednej cyfry, bez tworzenia VeryLongInt
+ * z drugiego argumentu. Wyniki, także NaN, są takie same jak po zamianie argumentu
+ * na VeryLongInt(n). Jak w konstruktorach, bool i char nie są traktowane jak liczby.
+ */
+namespace vliscalar
+{
+
+template<class T>
+using Enable = typename std::enable_if<
+    std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value>::type;
+
+struct Ops
+{
+    static void add(VeryLongInt& x, BaseType b);      //x += b
+    static void sub(VeryLongInt& x, BaseType b);      //x -= b
+    static void mul(VeryLongInt& x, BaseType b);      //x *= b
+    static void div(VeryLongInt& x, BaseType b);      //x /= b
+    static void mod(VeryLongInt& x, BaseType b);      //x %= b
+    static VeryLongInt sum(const VeryLongInt& a, BaseType b);
+    static VeryLongInt difference(const VeryLongInt& a, BaseType b);
+    static VeryLongInt product(const VeryLongInt& a, BaseType b);
+    static VeryLongInt quotient(const VeryLongInt& a, BaseType b);
+    static VeryLongInt remainder(const VeryLongInt& a, BaseType b);
+    //-1, 0 lub 1 dla poprawnej liczby a
+    static int compare(const VeryLongInt& a, BaseType b);
+};
+
+}
+
+/**
+ * Progi (w cyfrach BaseType) od których używane są asymptotycznie szybsze algorytmy.
+ * Wartości domyślne dobrane zostały pomiarami na x86-64; można je zmieniać
+ * w czasie działania programu (np. po strojeniu na konkretnej maszynie),
+ * ale nie równolegle z trwającymi obliczeniami.
+ */
+struct VeryLongIntThresholds
+{
+    std::size_t karatsubaMul = 40; //mnożenie Karatsuby od tylu cyfr krótszego argumentu
+    std::size_t toom3Mul = 250;    //mnożenie Toom-Cook 3
+    std::size_t nttMul = 12000;    //mnożenie przez transformatę teorioliczbową
+    std::size_t karatsubaSqr = 40; //podnoszenie do kwadratu metodą Karatsuby
+    std::size_t toom3Sqr = 250;    //podnoszenie do kwadratu metodą Toom-Cook 3
+    std::size_t divideAndConquerDiv = 50; //dzielenie rekurencyjne (Burnikel-Ziegler)
+    std::size_t decimalConversion = 20;   //rekurencyjna konwersja na zapis dziesiętny
+    std::size_t decimalParse = 100;       //rekurencyjne wczytywanie zapisu dziesiętnego
+    std::size_t parallelMul = 2000;       //równoległe podproblemy mnożenia (przy threadLimit() > 1)
+};
+
+const VeryLongIntThresholds& thresholds();
+void setThresholds(const VeryLongIntThresholds& value);
+
+//Zwalnia bufory pomocnicze, które bieżący wątek zachowuje między wywołaniami
+//(np. bufory transformat przy mnożeniu bardzo dużych liczb)
+void releaseScratchMemory();
+
+/**
+ * Liczba wątków, na których wykonywane jest mnożenie bardzo dużych liczb
+ * (a przez nie także dzielenie, pierwiastki i konwersje). Domyślnie 1 - obliczenia
+ * są sekwencyjne. 0 oznacza liczbę wątków sprzętowych. Wynik nie zależy od liczby
+ * wątków. Wątki pomocnicze tworzone są przy zmianie limitu, której nie wolno
+ * wykonywać równolegle z trwającymi obliczeniami.
+ */
+void setThreadLimit(unsigned count);
+unsigned threadLimit();
 
 const VeryLongInt& Zero(); //(42)
 const VeryLongInt& NaN();
@@ -81,19 +166,40 @@ const VeryLongInt& NaN();
 class VeryLongInt
 {
 private:
-    std::vector<BaseType> storage;
+    LimbStorage storage;
     bool isNaN;
 
     VeryLongInt& truncate();
-    VeryLongInt performDivision( const VeryLongInt& dividend_in,
-                                  const VeryLongInt& divisor_in,
-                                  VeryLongInt* remainder_out);
-    bool validateString(const char* str) const;
+    static void performDivision(const VeryLongInt& dividend,
+                                const VeryLongInt& divisor,
+                                VeryLongInt* quotient_out,
+                                VeryLongInt* remainder_out);
+    //result = gcd(a, b) dla a >= b > 0; jeśli cofactor != nullptr, zapisuje do niego
+    //|u| takie, że gcd = s a + u b, a do *cofactorNegative znak u (very_long_int_gcd.cc)
+    static void performGcd(const VeryLongInt& a, const VeryLongInt& b, VeryLongInt& result,
+                           VeryLongInt* cofactor, bool* cofactorNegative);
+    void parseDecimal(const char* str, std::size_t len);
+    //*this = a * b; bufor *this jest używany ponownie, o ile nie jest argumentem
+    VeryLongInt& assignProduct(const VeryLongInt& a, const VeryLongInt& b);
+    //*this += a * b bez tworzenia tymczasowej liczby dla iloczynu
+    VeryLongInt& addProduct(const VeryLongInt& a, const VeryLongInt& b);
+
+    //Liczba bez kopii cyfr limbs[0..n) (bez wiodących zer) - dla VeryLongIntView
+    VeryLongInt(LimbStorage::Borrowed tag, const BaseType* limbs, std::size_t n)
+        : storage(tag, limbs, n), isNaN(false) {}
+
+    //warstwa wyrażeń leniwych (very_long_int_expr.h) korzysta z powyższych operacji
+    friend struct vliexpr::Evaluator;
+    //działania z wbudowanymi liczbami operują bezpośrednio na cyfrach
+    friend struct vliscalar::Ops;
 public:
 
     //konstruktor kopiujący/przenoszący
     VeryLongInt(const VeryLongInt& other) = default; //(2)
     VeryLongInt(VeryLongInt&& other) = default; //(3)
+    //kopia z cyframi w podanym zasobie pamięci (patrz limbResource())
+    VeryLongInt(const VeryLongInt& other, std::pmr::memory_resource* resource)
+        : storage(other.storage, resource), isNaN(other.isNaN) {}
 
     VeryLongInt(bool) = delete;
     VeryLongInt(char) = delete;
@@ -135,6 +241,16 @@ public:
 
     unsigned long long numberOfBinaryDigits() const; //(8)
 
+    //Operacje na pojedynczych bitach; bit 0 jest najmłodszy. Dla NaN testBit zwraca false,
+    //a setBit i clearBit niczego nie zmieniają.
+    bool testBit(unsigned long long i) const;
+    VeryLongInt& setBit(unsigned long long i);
+    VeryLongInt& clearBit(unsigned long long i);
+    //Liczba bitów równych 1 (0 dla NaN)
+    unsigned long long popcount() const;
+    //Liczba zer na najmłodszych pozycjach zapisu dwójkowego (0 dla liczby 0 i NaN)
+    unsigned long long countTrailingZeros() const;
+
     bool isValid() const; //(9)
 
     VeryLongInt& operator+=(const VeryLongInt& rhs); //(10)
@@ -144,27 +260,566 @@ public:
     VeryLongInt& operator%=(const VeryLongInt& rhs); //(14)
     VeryLongInt& operator>>=(unsigned long long i); //(15)
     VeryLongInt& operator<<=(unsigned long long i); //(16)
+    VeryLongInt& operator&=(const VeryLongInt& rhs);
+    VeryLongInt& operator|=(const VeryLongInt& rhs);
+    VeryLongInt& operator^=(const VeryLongInt& rhs);
+
+    //Wersje z wbudowaną liczbą całkowitą (patrz vliscalar)
+    template<class T, class = vliscalar::Enable<T>>
+    VeryLongInt& operator+=(T rhs) { vliscalar::Ops::add(*this, static_cast<BaseType> (rhs)); return *this; }
+    template<class T, class = vliscalar::Enable<T>>
+    VeryLongInt& operator-=(T rhs) { vliscalar::Ops::sub(*this, static_cast<BaseType> (rhs)); return *this; }
+    template<class T, class = vliscalar::Enable<T>>
+    VeryLongInt& operator*=(T rhs) { vliscalar::Ops::mul(*this, static_cast<BaseType> (rhs)); return *this; }
+    template<class T, class = vliscalar::Enable<T>>
+    VeryLongInt& operator/=(T rhs) { vliscalar::Ops::div(*this, static_cast<BaseType> (rhs)); return *this; }
+    template<class T, class = vliscalar::Enable<T>>
+    VeryLongInt& operator%=(T rhs) { vliscalar::Ops::mod(*this, static_cast<BaseType> (rhs)); return *this; }
 
     //VeryLongInt is so happy to have so many friends!
 
+    //Wypisuje w systemie wybranym flagami strumienia (std::dec, std::hex, std::oct),
+    //z uwzględnieniem std::showbase i std::uppercase
     friend std::ostream& operator<<(std::ostream& out, const VeryLongInt& obj); //(40)
+    //Wczytuje liczbę w systemie wybranym flagami strumienia; w systemie szesnastkowym
+    //dopuszcza przedrostek 0x, a przy wyłączonych flagach systemu (std::setbase(0))
+    //rozpoznaje go po przedrostku (0x - szesnastkowy, 0 - ósemkowy). Wczytuje też "NaN".
+    //Gdy nie ma żadnej cyfry, ustawia failbit, a obj jest NaN. Cyfry przetwarzane są
+    //blokami w trakcie czytania, bez gromadzenia całego zapisu w pamięci.
+    friend std::istream& operator>>(std::istream& in, VeryLongInt& obj);
+    friend VeryLongIntOrdering compare(const VeryLongInt& lhs, const VeryLongInt& rhs);
     friend bool operator==(const VeryLongInt& lhs, const VeryLongInt& rhs); //(30)
-    friend bool operator<=(const VeryLongInt& lhs,const VeryLongInt& rhs); //(32)
+    friend VeryLongInt operator*(const VeryLongInt& lhs, const VeryLongInt& rhs); //(22)
+    friend VeryLongInt operator/(const VeryLongInt& lhs, const VeryLongInt& rhs); //(23)
+    friend VeryLongInt operator%(const VeryLongInt& lhs, const VeryLongInt& rhs); //(24)
+    friend VeryLongInt operator&(const VeryLongInt& lhs, const VeryLongInt& rhs);
+    friend VeryLongInt operator|(const VeryLongInt& lhs, const VeryLongInt& rhs);
+    friend VeryLongInt operator^(const VeryLongInt& lhs, const VeryLongInt& rhs);
+    friend void divmod(const VeryLongInt& dividend, const VeryLongInt& divisor,
+                       VeryLongInt& quotient, VeryLongInt& remainder);
+    friend BaseType divmod(const VeryLongInt& dividend, BaseType divisor, VeryLongInt& quotient);
+    friend VeryLongInt powmod(const VeryLongInt& base, const VeryLongInt& exponent,
+                              const VeryLongInt& modulus);
+    friend VeryLongInt pow(const VeryLongInt& base, unsigned long long exponent);
+    friend VeryLongInt iroot(const VeryLongInt& x, unsigned long long k);
+    friend VeryLongInt gcd(const VeryLongInt& a, const VeryLongInt& b);
+    friend VeryLongIntBezout extendedGcd(const VeryLongInt& a, const VeryLongInt& b);
+    friend VeryLongInt modinv(const VeryLongInt& a, const VeryLongInt& modulus);
+    friend class VeryLongIntMontgomery;
+    friend class VeryLongIntDivisor;
+    friend VeryLongInt sum(const VeryLongInt* values, std::size_t count);
+    friend VeryLongInt product(const VeryLongInt* values, std::size_t count);
+    friend class VeryLongIntView;
+    friend std::size_t limbCount(const VeryLongInt& x);
+    friend std::size_t toLimbs(const VeryLongInt& x, BaseType* out);
+    friend VeryLongInt fromLimbs(const BaseType* limbs, std::size_t count);
+    friend std::size_t toBytes(const VeryLongInt& x, unsigned char* out, VeryLongIntByteOrder order);
+    friend std::size_t writeBinary(const VeryLongInt& x, unsigned char* out);
+    friend std::ostream& writeBinary(std::ostream& out, const VeryLongInt& x);
+    friend std::size_t readBinary(const unsigned char* data, std::size_t size, VeryLongInt& x);
+    friend std::istream& readBinary(std::istream& in, VeryLongInt& x);
+    friend std::size_t charsUpperBound(const VeryLongInt& x, unsigned base);
+    friend std::to_chars_result toChars(char* first, char* last, const VeryLongInt& x,
+                                        unsigned base, bool uppercase);
+    friend std::from_chars_result fromChars(const char* first, const char* last,
+                                            VeryLongInt& x, unsigned base);
 
     explicit operator bool() const; //(41)
 
 };
 
-const VeryLongInt operator+(const VeryLongInt& lhs, const VeryLongInt& rhs); //(20)
-const VeryLongInt operator-(const VeryLongInt& lhs, const VeryLongInt& rhs); //(21)
-const VeryLongInt operator*(const VeryLongInt& lhs, const VeryLongInt& rhs); //(22)
-const VeryLongInt operator/(const VeryLongInt& lhs, const VeryLongInt& rhs); //(23)
-const VeryLongInt operator%(const VeryLongInt& lhs, const VeryLongInt& rhs); //(24)
-const VeryLongInt operator>>(const VeryLongInt& lhs, unsigned long long i); //(25)
-const VeryLongInt operator<<(const VeryLongInt& lhs, unsigned long long i); //(26)
+//Zapis x w systemie o podstawie base: 10 albo potęga dwójki od 2 do 32 (cyfry 0-9, a-v,
+//wielkie litery dla uppercase). Dla potęg dwójki konwersja jest liniowa. "NaN" dla nieliczby,
+//pusty napis dla nieobsługiwanej podstawy.
+std::string toString(const VeryLongInt& x, unsigned base = 10, bool uppercase = false);
+//Liczba z zapisu w systemie o podstawie base (jak wyżej, litery dowolnej wielkości).
+//NaN dla pustego napisu, znaku spoza systemu lub nieobsługiwanej podstawy.
+VeryLongInt fromString(const std::string& str, unsigned base = 10);
+
+//Górne ograniczenie długości zapisu x przez toChars (dla potęg dwójki - dokładna długość);
+//3 dla NaN, 0 dla nieobsługiwanej podstawy
+std::size_t charsUpperBound(const VeryLongInt& x, unsigned base = 10);
+//Zapisuje x do [first, last) jak std::to_chars (bez kończącego zera); "NaN" dla nieliczby.
+//Bufor o długości charsUpperBound(x, base) zawsze wystarcza i wtedy nic nie jest alokowane.
+//Za krótki bufor daje errc::value_too_large, nieobsługiwana podstawa errc::invalid_argument.
+std::to_chars_result toChars(char* first, char* last, const VeryLongInt& x,
+                             unsigned base = 10, bool uppercase = false);
+//Wczytuje z [first, last) najdłuższy ciąg cyfr (lub "NaN") jak std::from_chars - ptr wskazuje
+//pierwszy znak za nim. Cyfry zapisywane są w pamięci x, jeśli ta jest wystarczająca.
+//Bez żadnej cyfry zwraca {first, errc::invalid_argument}, a x pozostaje bez zmian.
+std::from_chars_result fromChars(const char* first, const char* last, VeryLongInt& x,
+                                 unsigned base = 10);
+
+//Wyniki nie są const, aby można było je przenosić. Wersje przyjmujące argument
+//tymczasowy (&&) liczą wynik w jego buforze zamiast kopiować drugi argument,
+//np. a + b + c tworzy tylko jedną nową liczbę.
+VeryLongInt operator+(const VeryLongInt& lhs, const VeryLongInt& rhs); //(20)
+VeryLongInt operator+(VeryLongInt&& lhs, const VeryLongInt& rhs);
+VeryLongInt operator+(const VeryLongInt& lhs, VeryLongInt&& rhs);
+VeryLongInt operator+(VeryLongInt&& lhs, VeryLongInt&& rhs);
+VeryLongInt operator-(const VeryLongInt& lhs, const VeryLongInt& rhs); //(21)
+VeryLongInt operator-(VeryLongInt&& lhs, const VeryLongInt& rhs);
+VeryLongInt operator*(const VeryLongInt& lhs, const VeryLongInt& rhs); //(22)
+VeryLongInt operator/(const VeryLongInt& lhs, const VeryLongInt& rhs); //(23)
+VeryLongInt operator%(const VeryLongInt& lhs, const VeryLongInt& rhs); //(24)
+VeryLongInt operator>>(const VeryLongInt& lhs, unsigned long long i); //(25)
+VeryLongInt operator>>(VeryLongInt&& lhs, unsigned long long i);
+VeryLongInt operator<<(const VeryLongInt& lhs, unsigned long long i); //(26)
+VeryLongInt operator<<(VeryLongInt&& lhs, unsigned long long i);
+
+//Działania bitowe, wykonywane całymi cyframi; NaN, jeśli któryś argument jest NaN.
+//Nie ma negacji (~) - dla liczby nieujemnej bez ustalonej szerokości wynik nie byłby
+//liczbą nieujemną. Wersje przyjmujące argument tymczasowy liczą wynik w jego buforze.
+VeryLongInt operator&(const VeryLongInt& lhs, const VeryLongInt& rhs);
+VeryLongInt operator&(VeryLongInt&& lhs, const VeryLongInt& rhs);
+VeryLongInt operator&(const VeryLongInt& lhs, VeryLongInt&& rhs);
+VeryLongInt operator&(VeryLongInt&& lhs, VeryLongInt&& rhs);
+VeryLongInt operator|(const VeryLongInt& lhs, const VeryLongInt& rhs);
+VeryLongInt operator|(VeryLongInt&& lhs, const VeryLongInt& rhs);
+VeryLongInt operator|(const VeryLongInt& lhs, VeryLongInt&& rhs);
+VeryLongInt operator|(VeryLongInt&& lhs, VeryLongInt&& rhs);
+VeryLongInt operator^(const VeryLongInt& lhs, const VeryLongInt& rhs);
+VeryLongInt operator^(VeryLongInt&& lhs, const VeryLongInt& rhs);
+VeryLongInt operator^(const VeryLongInt& lhs, VeryLongInt&& rhs);
+VeryLongInt operator^(VeryLongInt&& lhs, VeryLongInt&& rhs);
+
+//Wynik porównania dwóch liczb; unordered, gdy któraś z nich jest NaN
+enum class VeryLongIntOrdering
+{
+    less,
+    equal,
+    greater,
+    unordered
+};
+
+//Porównanie trójwartościowe jednym przejściem od najstarszej cyfry. Operatory <, <=, >, >=
+//korzystają z niego, więc każdy z nich przegląda cyfry co najwyżej raz.
+VeryLongIntOrdering compare(const VeryLongInt& lhs, const VeryLongInt& rhs);
 
 bool operator!=(const VeryLongInt& lhs,const VeryLongInt& rhs); //(31)
+bool operator<=(const VeryLongInt& lhs,const VeryLongInt& rhs); //(32)
 bool operator>=(const VeryLongInt& lhs,const VeryLongInt& rhs); //(33)
 bool operator<(const VeryLongInt& lhs,const VeryLongInt& rhs); //(34)
 bool operator>(const VeryLongInt& lhs,const VeryLongInt& rhs); //(35)
 
+#if defined(__cpp_impl_three_way_comparison)
+//W C++20 także a <=> b (std::partial_ordering::unordered dla NaN)
+inline std::partial_ordering operator<=>(const VeryLongInt& lhs, const VeryLongInt& rhs)
+{
+    switch (compare(lhs, rhs))
+    {
+    case VeryLongIntOrdering::less:
+        return std::partial_ordering::less;
+    case VeryLongIntOrdering::equal:
+        return std::partial_ordering::equivalent;
+    case VeryLongIntOrdering::greater:
+        return std::partial_ordering::greater;
+    default:
+        return std::partial_ordering::unordered;
+    }
+}
+#endif
+
+//Działania z wbudowaną liczbą całkowitą po dowolnej stronie (patrz vliscalar). Lewy argument
+//wbudowany w -, / i % daje wynik co najwyżej jednocyfrowy, liczony w nim samym.
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator+(const VeryLongInt& lhs, T rhs)
+{
+    return vliscalar::Ops::sum(lhs, static_cast<BaseType> (rhs));
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator+(VeryLongInt&& lhs, T rhs)
+{
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator+(T lhs, const VeryLongInt& rhs)
+{
+    return vliscalar::Ops::sum(rhs, static_cast<BaseType> (lhs));
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator+(T lhs, VeryLongInt&& rhs)
+{
+    rhs += lhs;
+    return std::move(rhs);
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator-(const VeryLongInt& lhs, T rhs)
+{
+    return vliscalar::Ops::difference(lhs, static_cast<BaseType> (rhs));
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator-(VeryLongInt&& lhs, T rhs)
+{
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator-(T lhs, const VeryLongInt& rhs)
+{
+    VeryLongInt result(static_cast<BaseType> (lhs));
+    result -= rhs;
+    return result;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator*(const VeryLongInt& lhs, T rhs)
+{
+    return vliscalar::Ops::product(lhs, static_cast<BaseType> (rhs));
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator*(VeryLongInt&& lhs, T rhs)
+{
+    lhs *= rhs;
+    return std::move(lhs);
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator*(T lhs, const VeryLongInt& rhs)
+{
+    return vliscalar::Ops::product(rhs, static_cast<BaseType> (lhs));
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator*(T lhs, VeryLongInt&& rhs)
+{
+    rhs *= lhs;
+    return std::move(rhs);
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator/(const VeryLongInt& lhs, T rhs)
+{
+    return vliscalar::Ops::quotient(lhs, static_cast<BaseType> (rhs));
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator/(VeryLongInt&& lhs, T rhs)
+{
+    lhs /= rhs;
+    return std::move(lhs);
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator/(T lhs, const VeryLongInt& rhs)
+{
+    VeryLongInt result(static_cast<BaseType> (lhs));
+    result /= rhs;
+    return result;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator%(const VeryLongInt& lhs, T rhs)
+{
+    return vliscalar::Ops::remainder(lhs, static_cast<BaseType> (rhs));
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator%(VeryLongInt&& lhs, T rhs)
+{
+    lhs %= rhs;
+    return std::move(lhs);
+}
+
+template<class T, class = vliscalar::Enable<T>>
+VeryLongInt operator%(T lhs, const VeryLongInt& rhs)
+{
+    VeryLongInt result(static_cast<BaseType> (lhs));
+    result %= rhs;
+    return result;
+}
+
+//Porównania z NaN są fałszywe, jak dla dwóch VeryLongInt
+template<class T, class = vliscalar::Enable<T>>
+bool operator==(const VeryLongInt& lhs, T rhs)
+{
+    return lhs.isValid() && vliscalar::Ops::compare(lhs, static_cast<BaseType> (rhs)) == 0;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator!=(const VeryLongInt& lhs, T rhs)
+{
+    return lhs.isValid() && vliscalar::Ops::compare(lhs, static_cast<BaseType> (rhs)) != 0;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator<(const VeryLongInt& lhs, T rhs)
+{
+    return lhs.isValid() && vliscalar::Ops::compare(lhs, static_cast<BaseType> (rhs)) < 0;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator<=(const VeryLongInt& lhs, T rhs)
+{
+    return lhs.isValid() && vliscalar::Ops::compare(lhs, static_cast<BaseType> (rhs)) <= 0;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator>(const VeryLongInt& lhs, T rhs)
+{
+    return lhs.isValid() && vliscalar::Ops::compare(lhs, static_cast<BaseType> (rhs)) > 0;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator>=(const VeryLongInt& lhs, T rhs)
+{
+    return lhs.isValid() && vliscalar::Ops::compare(lhs, static_cast<BaseType> (rhs)) >= 0;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator==(T lhs, const VeryLongInt& rhs)
+{
+    return rhs == lhs;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator!=(T lhs, const VeryLongInt& rhs)
+{
+    return rhs != lhs;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator<(T lhs, const VeryLongInt& rhs)
+{
+    return rhs > lhs;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator<=(T lhs, const VeryLongInt& rhs)
+{
+    return rhs >= lhs;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator>(T lhs, const VeryLongInt& rhs)
+{
+    return rhs < lhs;
+}
+
+template<class T, class = vliscalar::Enable<T>>
+bool operator>=(T lhs, const VeryLongInt& rhs)
+{
+    return rhs <= lhs;
+}
+
+//Iloraz i reszta z dzielenia wyznaczone jednym dzieleniem
+struct VeryLongIntDivision
+{
+    VeryLongInt quotient;
+    VeryLongInt remainder;
+};
+
+//Dla dzielenia przez 0 lub NaN oba wyniki są NaN
+VeryLongIntDivision divmod(const VeryLongInt& dividend, const VeryLongInt& divisor);
+//Jak wyżej, ale wyniki zapisywane są do istniejących obiektów (z użyciem ich pamięci).
+//quotient i remainder muszą być różnymi obiektami; mogą być argumentami.
+void divmod(const VeryLongInt& dividend, const VeryLongInt& divisor,
+            VeryLongInt& quotient, VeryLongInt& remainder);
+//Dzielenie przez jedną cyfrę: zwraca resztę, iloraz zapisuje do quotient (może być dividend).
+//Dla dzielenia przez 0 lub NaN quotient jest NaN, a zwracana reszta równa 0.
+BaseType divmod(const VeryLongInt& dividend, BaseType divisor, VeryLongInt& quotient);
+
+//base^exponent (0^0 = 1); NaN dla argumentu NaN
+VeryLongInt pow(const VeryLongInt& base, unsigned long long exponent);
+//Pierwiastek kwadratowy zaokrąglony w dół; NaN dla argumentu NaN
+VeryLongInt isqrt(const VeryLongInt& x);
+//Pierwiastek stopnia k zaokrąglony w dół; NaN dla argumentu NaN lub k = 0
+VeryLongInt iroot(const VeryLongInt& x, unsigned long long k);
+
+//Największy wspólny dzielnik; gcd(0, 0) = 0, NaN dla argumentu NaN
+VeryLongInt gcd(const VeryLongInt& a, const VeryLongInt& b);
+
+//Wynik rozszerzonego algorytmu Euklidesa: gcd = x a - y b, a gdy xNegative,
+//gcd = y b - x a. Współczynniki są najmniejsze z możliwych: x <= b / gcd, y <= a / gcd.
+struct VeryLongIntBezout
+{
+    VeryLongInt gcd;
+    VeryLongInt x;
+    VeryLongInt y;
+    bool xNegative;
+};
+
+//Dla argumentu NaN wszystkie trzy liczby są NaN
+VeryLongIntBezout extendedGcd(const VeryLongInt& a, const VeryLongInt& b);
+//a^(-1) mod modulus; NaN dla modułu 0, argumentu NaN lub gdy gcd(a, modulus) != 1
+VeryLongInt modinv(const VeryLongInt& a, const VeryLongInt& modulus);
+
+//base^exponent mod modulus; NaN dla modułu 0 lub argumentu NaN
+VeryLongInt powmod(const VeryLongInt& base, const VeryLongInt& exponent, const VeryLongInt& modulus);
+
+/**
+ * Kontekst mnożenia Montgomery'ego dla ustalonego nieparzystego modułu m > 1
+ * (n cyfr): przechowuje B^2n mod m oraz -m^(-1) mod B. Pozwala wielokrotnie
+ * potęgować modulo m bez ponownego wyznaczania tych wartości. Dla modułu
+ * parzystego, równego 1 lub NaN kontekst jest niepoprawny (isValid() == false),
+ * a powmod zwraca NaN.
+ */
+class VeryLongIntMontgomery
+{
+public:
+    explicit VeryLongIntMontgomery(const VeryLongInt& modulus);
+
+    bool isValid() const;
+    const VeryLongInt& modulus() const;
+
+    //base^exponent mod modulus()
+    VeryLongInt powmod(const VeryLongInt& base, const VeryLongInt& exponent) const;
+
+private:
+    VeryLongInt mod;
+    LimbStorage squaredRadix; //B^2n mod m, uzupełnione zerami do n cyfr
+    BaseType inverse;         //-m^(-1) mod B
+};
+
+/**
+ * Dzielnik przygotowany do wielokrotnego dzielenia przez tę samą liczbę d != 0:
+ * przechowuje d przesunięte do postaci znormalizowanej (najstarszy bit ustawiony)
+ * oraz odwrotność jego najstarszej cyfry (dwóch cyfr dla d wielocyfrowego),
+ * dzięki czemu każde dzielenie pomija normalizację dzielnika, a cyfry ilorazu
+ * wyznaczane są mnożeniami zamiast sprzętowego dzielenia 128/64.
+ * Dla d równego 0 lub NaN dzielnik jest niepoprawny (isValid() == false),
+ * a wyniki dzielenia są NaN.
+ */
+class VeryLongIntDivisor
+{
+public:
+    explicit VeryLongIntDivisor(const VeryLongInt& divisor);
+
+    bool isValid() const;
+    const VeryLongInt& value() const;
+
+    VeryLongInt div(const VeryLongInt& dividend) const;
+    VeryLongInt mod(const VeryLongInt& dividend) const;
+    VeryLongIntDivision divmod(const VeryLongInt& dividend) const;
+    //Jak divmod(a, d, quotient, remainder) - wyniki trafiają do istniejących obiektów
+    void divmod(const VeryLongInt& dividend, VeryLongInt& quotient, VeryLongInt& remainder) const;
+
+private:
+    void divide(const VeryLongInt& dividend, VeryLongInt* quotient_out, VeryLongInt* remainder_out) const;
+
+    VeryLongInt divisor;
+    LimbStorage normalized; //divisor << shift
+    unsigned shift;
+    BaseType reciprocal;    //reciprocal2by1 dla jednej cyfry, reciprocal3by2 dla wielu
+};
+
+VeryLongInt operator/(const VeryLongInt& lhs, const VeryLongIntDivisor& rhs);
+VeryLongInt operator%(const VeryLongInt& lhs, const VeryLongIntDivisor& rhs);
+
+//Suma values[0..count) (0 dla count = 0); NaN, jeśli któraś z liczb jest NaN.
+//Wynik składany jest w jednym buforze, bez wyników pośrednich.
+VeryLongInt sum(const VeryLongInt* values, std::size_t count);
+//Iloczyn values[0..count) (1 dla count = 0); NaN, jeśli któraś z liczb jest NaN.
+//Liczony drzewem iloczynów zrównoważonym względem długości czynników, dzięki czemu
+//duże mnożenia mają argumenty podobnej długości (przy threadLimit() > 1 poddrzewa
+//liczone są równolegle).
+VeryLongInt product(const VeryLongInt* values, std::size_t count);
+
+/**
+ * Drzewo iloczynów modułów m_0, ..., m_(k-1): liście to moduły, a każdy węzeł
+ * jest iloczynem swoich dzieci. Pozwala wyznaczyć wszystkie reszty x mod m_i
+ * schodząc od korzenia (x mod iloczyn węzła jest redukowane modulo jego dzieci),
+ * czyli kosztem kilku mnożeń długości x zamiast k dzieleń długiego x.
+ * Węzły przechowywane są jako VeryLongIntDivisor, więc kolejne wywołania
+ * remainders dla tych samych modułów nie normalizują dzielników ponownie.
+ * Moduły równe 0 lub NaN nie należą do drzewa, a ich reszty są NaN.
+ */
+class VeryLongIntProductTree
+{
+public:
+    VeryLongIntProductTree(const VeryLongInt* moduli, std::size_t count);
+
+    //Iloczyn poprawnych modułów (1, jeśli nie ma żadnego)
+    const VeryLongInt& product() const;
+    //x mod moduli[i] dla kolejnych i; dla x równego NaN wszystkie reszty są NaN
+    std::vector<VeryLongInt> remainders(const VeryLongInt& x) const;
+
+private:
+    //levels[0] - poprawne moduły, levels[k + 1][i] = levels[k][2i] * levels[k][2i + 1]
+    //(ostatni węzeł poziomu o nieparzystej długości przechodzi wyżej bez zmian)
+    std::vector<std::vector<VeryLongIntDivisor>> levels;
+    //Pozycja modułu w levels[0] albo count dla modułów niepoprawnych
+    std::vector<std::size_t> positions;
+    VeryLongInt total;
+};
+
+//x mod moduli[i] dla i < count (drzewo reszt); patrz VeryLongIntProductTree
+std::vector<VeryLongInt> remainderTree(const VeryLongInt& x, const VeryLongInt* moduli, std::size_t count);
+
+/**
+ * Liczba oparta na cudzym buforze cyfr BaseType (od najmłodszej), np. na pliku
+ * odwzorowanym w pamięci - bez kopiowania. Widok zachowuje się jak stała liczba:
+ * może być argumentem wszystkich operacji (konwersja na const VeryLongInt&),
+ * a kopia zrobiona z value() ma już własne cyfry. Bufor musi żyć dłużej niż widok
+ * i nie może się zmieniać, dopóki widok jest używany. Wiodące zera bufora są pomijane.
+ */
+class VeryLongIntView
+{
+public:
+    VeryLongIntView(const BaseType* limbs, std::size_t count);
+    VeryLongIntView(const VeryLongIntView& other);
+    VeryLongIntView& operator=(const VeryLongIntView&) = delete;
+
+    const VeryLongInt& value() const { return number; }
+    operator const VeryLongInt&() const { return number; }
+
+private:
+    const VeryLongInt number;
+};
+
+//Liczba cyfr BaseType liczby x (co najmniej 1; 0 dla NaN)
+std::size_t limbCount(const VeryLongInt& x);
+//Kopiuje cyfry x od najmłodszej do out (limbCount(x) cyfr), zwraca ich liczbę
+std::size_t toLimbs(const VeryLongInt& x, BaseType* out);
+//Liczba z cyfr limbs[0..count) zapisanych od najmłodszej (0 dla count = 0)
+VeryLongInt fromLimbs(const BaseType* limbs, std::size_t count);
+
+enum class VeryLongIntByteOrder
+{
+    littleEndian, //najmłodszy bajt pierwszy
+    bigEndian     //najstarszy bajt pierwszy
+};
+
+//Liczba bajtów liczby x bez wiodących zer (co najmniej 1; 0 dla NaN)
+std::size_t byteCount(const VeryLongInt& x);
+//Zapisuje byteCount(x) bajtów x do out w podanej kolejności, zwraca ich liczbę
+std::size_t toBytes(const VeryLongInt& x, unsigned char* out,
+                    VeryLongIntByteOrder order = VeryLongIntByteOrder::littleEndian);
+//Liczba z bajtów bytes[0..count) w podanej kolejności (0 dla count = 0)
+VeryLongInt fromBytes(const unsigned char* bytes, std::size_t count,
+                      VeryLongIntByteOrder order = VeryLongIntByteOrder::littleEndian);
+
+/**
+ * Format binarny (wersja 1), wszystkie pola little-endian:
+ *   bajty 0..2  - "VLI"
+ *   bajt 3      - wersja formatu (1)
+ *   bajt 4      - flagi: bit 0 - NaN (wtedy brak cyfr)
+ *   bajty 5..7  - zarezerwowane (0)
+ *   bajty 8..15 - liczba cyfr n (64 bity)
+ *   dalej       - n cyfr po 8 bajtów, od najmłodszej
+ * Cyfry zaczynają się od bajtu 16, więc na maszynie little-endian zapis odwzorowany
+ * w pamięci (wyrównany do 8 bajtów) można użyć bez kopiowania przez VeryLongIntView.
+ */
+const unsigned binaryFormatVersion = 1;
+const std::size_t binaryHeaderSize = 16;
+
+//Rozmiar zapisu binarnego x w bajtach
+std::size_t binarySize(const VeryLongInt& x);
+//Zapisuje x do out (binarySize(x) bajtów), zwraca liczbę zapisanych bajtów
+std::size_t writeBinary(const VeryLongInt& x, unsigned char* out);
+//Odczytuje liczbę z data[0..size), zwraca liczbę odczytanych bajtów albo 0, jeśli dane
+//są niepełne, mają nieznaną wersję lub są niepoprawne (x jest wtedy NaN)
+std::size_t readBinary(const unsigned char* data, std::size_t size, VeryLongInt& x);
+std::ostream& writeBinary(std::ostream& out, const VeryLongInt& x);
+//Przy niepoprawnych danych ustawia failbit strumienia, a x jest NaN
+std::istream& readBinary(std::istream& in, VeryLongInt& x);
+
+#endif
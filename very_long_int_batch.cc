@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <vector>
+#include "very_long_int.h"
+#include "very_long_int_kernels.h"
+
+/**
+ * Operacje na wielu liczbach naraz: suma, iloczyn i reszty modulo wiele modułów.
+ *
+ * Mnożenie kolejnych czynników do rosnącego wyniku kosztuje k mnożeń długiej liczby
+ * przez krótką, więc szybkie algorytmy mnożenia nie mają okazji zadziałać. Drzewo
+ * iloczynów mnoży liczby podobnej długości, a koszt całości jest rzędu
+ * M(n) log k dla wyniku n cyfr.
+ *
+ * Wyniki pośrednie liczone na wątkach pomocniczych tworzone są z ich zasobu pamięci
+ * i przekazywane dalej przez przeniesienie (z zasobem), dzięki czemu wątki pomocnicze
+ * nie alokują z zasobu wątku wywołującego.
+ */
+namespace
+{
+
+struct Factor
+{
+    const BaseType* limbs;
+    std::size_t size;
+};
+
+//Liczba cyfr, od której czynniki liczone są drzewem zamiast kolejno w jednym buforze
+std::size_t leafLimbs()
+{
+    return std::max<std::size_t>(thresholds().karatsubaMul, 2);
+}
+
+//Czy poddrzewa o tylu cyfrach liczyć równolegle
+bool parallelSubtrees(std::size_t limbs)
+{
+    return vlikernel::parallelism() > 1 && limbs >= 2 * thresholds().parallelMul;
+}
+
+//Liczba węzłów o podanej długości w jednym zadaniu - tak, by zadanie obejmowało
+//około parallelMul cyfr
+std::size_t grain(std::size_t limbs)
+{
+    return std::max<std::size_t>(thresholds().parallelMul / std::max<std::size_t>(limbs, 1), 1);
+}
+
+//Iloczyn factors[first..last) bez wiodących zer (co najmniej jedna cyfra);
+//prefix[i] - łączna liczba cyfr factors[0..i), która wystarcza na wynik
+vlikernel::ScratchVector productRange(const Factor* factors, const std::size_t* prefix,
+                                      std::size_t first, std::size_t last)
+{
+    const std::size_t limbs = prefix[last] - prefix[first];
+    if (last - first == 1 || limbs <= leafLimbs())
+    {
+        //Mało cyfr - mnożenie pisemne kolejnych czynników w jednym buforze
+        vlikernel::ScratchVector result(limbs, limbResource());
+        vlikernel::ScratchVector product(limbResource());
+        BaseType* rp = result.data();
+        std::copy(factors[first].limbs, factors[first].limbs + factors[first].size, rp);
+        std::size_t n = factors[first].size;
+        for (std::size_t i = first + 1; i < last; i++)
+        {
+            const Factor& f = factors[i];
+            if (f.size == 1)
+                rp[n] = vlikernel::mul1(rp, rp, n, f.limbs[0]);
+            else
+            {
+                product.resize(n + f.size);
+                vlikernel::mulBasecase(product.data(), rp, n, f.limbs, f.size);
+                std::copy(product.begin(), product.end(), rp);
+            }
+            n += f.size;
+            while (n > 1 && rp[n - 1] == 0)
+                n--;
+        }
+        result.resize(n);
+        return result;
+    }
+
+    //Podział w połowie łącznej liczby cyfr, z co najmniej jednym czynnikiem po każdej stronie
+    std::size_t middle = std::lower_bound(prefix + first + 1, prefix + last, prefix[first] + limbs / 2) - prefix;
+    middle = std::min(middle, last - 1);
+
+    std::optional<vlikernel::ScratchVector> left, right;
+    const std::function<void()> tasks[2] = {
+        [&] { left.emplace(productRange(factors, prefix, first, middle)); },
+        [&] { right.emplace(productRange(factors, prefix, middle, last)); }
+    };
+    if (parallelSubtrees(limbs))
+        vlikernel::parallelInvoke(tasks, 2);
+    else
+    {
+        tasks[0]();
+        tasks[1]();
+    }
+
+    vlikernel::ScratchVector result(left->size() + right->size(), limbResource());
+    vlikernel::mul(result.data(), left->data(), left->size(), right->data(), right->size());
+    std::size_t n = result.size();
+    while (n > 1 && result[n - 1] == 0)
+        n--;
+    result.resize(n);
+    return result;
+}
+
+}
+
+VeryLongInt sum(const VeryLongInt* values, std::size_t count)
+{
+    std::size_t longest = 1;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (values[i].isNaN)
+            return NaN();
+        longest = std::max(longest, values[i].storage.size());
+    }
+
+    //Suma mniej niż B liczb o co najwyżej longest cyfrach mieści się w longest + 1 cyfrach;
+    //przeniesienie za krótszym składnikiem zwykle wygasa po jednej cyfrze
+    VeryLongInt result;
+    result.storage.resize(longest + 1, 0);
+    BaseType* rp = result.storage.data();
+    for (std::size_t i = 0; i < count; i++)
+        vlikernel::add(rp, rp, longest + 1, values[i].storage.data(), values[i].storage.size());
+    return result.truncate();
+}
+
+VeryLongInt product(const VeryLongInt* values, std::size_t count)
+{
+    if (count == 0)
+        return 1;
+    std::vector<Factor> factors(count);
+    std::vector<std::size_t> prefix(count + 1, 0);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (values[i].isNaN)
+            return NaN();
+        factors[i] = Factor{values[i].storage.data(), values[i].storage.size()};
+        prefix[i + 1] = prefix[i] + values[i].storage.size();
+    }
+
+    vlikernel::ScratchVector limbs = productRange(factors.data(), prefix.data(), 0, count);
+    VeryLongInt result;
+    result.storage.resize(limbs.size());
+    std::copy(limbs.begin(), limbs.end(), result.storage.data());
+    return result;
+}
+
+VeryLongIntProductTree::VeryLongIntProductTree(const VeryLongInt* moduli, std::size_t count)
+    : positions(count, count)
+{
+    levels.emplace_back();
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (moduli[i].isValid() && moduli[i] != 0)
+        {
+            positions[i] = levels[0].size();
+            levels[0].emplace_back(moduli[i]);
+        }
+    }
+    if (levels[0].empty())
+    {
+        total = 1;
+        return;
+    }
+
+    while (levels.back().size() > 1)
+    {
+        const std::vector<VeryLongIntDivisor>& below = levels.back();
+        const std::size_t pairs = below.size() / 2;
+        std::vector<std::optional<VeryLongInt>> products(pairs);
+        vlikernel::parallelFor(pairs, grain(below[0].value().numberOfBinaryDigits() / vlikernel::baseBits),
+                               [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+                products[i].emplace(below[2 * i].value() * below[2 * i + 1].value());
+        });
+
+        std::vector<VeryLongIntDivisor> above;
+        above.reserve(pairs + 1);
+        for (std::optional<VeryLongInt>& p : products)
+            above.emplace_back(*p);
+        if (below.size() % 2 != 0)
+            above.push_back(below.back());
+        levels.push_back(std::move(above));
+    }
+    total = levels.back()[0].value();
+}
+
+const VeryLongInt& VeryLongIntProductTree::product() const
+{
+    return total;
+}
+
+std::vector<VeryLongInt> VeryLongIntProductTree::remainders(const VeryLongInt& x) const
+{
+    const std::size_t count = positions.size();
+    std::vector<VeryLongInt> result(count, NaN());
+    if (!x.isValid() || levels[0].empty())
+        return result;
+
+    //Reszty modulo węzły kolejnych poziomów, od korzenia w dół
+    std::vector<std::optional<VeryLongInt>> current(1);
+    current[0].emplace(x % levels.back()[0]);
+    for (std::size_t level = levels.size() - 1; level > 0; level--)
+    {
+        const std::vector<VeryLongIntDivisor>& nodes = levels[level - 1];
+        std::vector<std::optional<VeryLongInt>> next(nodes.size());
+        vlikernel::parallelFor(nodes.size(), grain(nodes[0].value().numberOfBinaryDigits() / vlikernel::baseBits),
+                               [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                //Ostatni węzeł poziomu o nieparzystej długości jest zarazem węzłem wyższego
+                //poziomu - reszta modulo on jest już wyznaczona
+                const VeryLongInt& parent = *current[i / 2];
+                if (i == nodes.size() - 1 && nodes.size() % 2 != 0)
+                    next[i].emplace(parent);
+                else
+                    next[i].emplace(parent % nodes[i]);
+            }
+        });
+        current.swap(next);
+    }
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (positions[i] < count)
+            result[i] = std::move(*current[positions[i]]);
+    }
+    return result;
+}
+
+std::vector<VeryLongInt> remainderTree(const VeryLongInt& x, const VeryLongInt* moduli, std::size_t count)
+{
+    return VeryLongIntProductTree(moduli, count).remainders(x);
+}
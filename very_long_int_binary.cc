@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include "very_long_int.h"
+#include "very_long_int_kernels.h"
+
+/**
+ * Zapis binarny i wymiana cyfr z zewnętrznymi buforami.
+ *
+ * Format binarny zapisuje cyfry wprost (bez konwersji na inną podstawę), więc zapis
+ * i odczyt kosztują tyle co kopiowanie pamięci. Na maszynach little-endian cyfry
+ * kopiowane są jednym memcpy, na pozostałych - bajt po bajcie.
+ */
+namespace
+{
+
+const int limbBytes = sizeof(BaseType);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+const bool nativeLittleEndian = true;
+#else
+const bool nativeLittleEndian = false;
+#endif
+
+void storeLittleEndian(unsigned char* out, const BaseType* limbs, std::size_t n)
+{
+    if (nativeLittleEndian)
+    {
+        std::memcpy(out, limbs, n * limbBytes);
+        return;
+    }
+    for (std::size_t i = 0; i < n; i++)
+        for (int j = 0; j < limbBytes; j++)
+            out[i * limbBytes + j] = static_cast<unsigned char> (limbs[i] >> (8 * j));
+}
+
+void loadLittleEndian(BaseType* limbs, const unsigned char* in, std::size_t n)
+{
+    if (nativeLittleEndian)
+    {
+        std::memcpy(limbs, in, n * limbBytes);
+        return;
+    }
+    for (std::size_t i = 0; i < n; i++)
+    {
+        BaseType limb = 0;
+        for (int j = 0; j < limbBytes; j++)
+            limb |= static_cast<BaseType> (in[i * limbBytes + j]) << (8 * j);
+        limbs[i] = limb;
+    }
+}
+
+//Liczba cyfr bez wiodących zer (co najmniej 1)
+std::size_t significantLimbs(const BaseType* limbs, std::size_t n)
+{
+    while (n > 1 && limbs[n - 1] == 0)
+        n--;
+    return n;
+}
+
+const BaseType zeroLimb = 0;
+
+const unsigned char flagNaN = 1;
+
+//Zapisuje nagłówek formatu binarnego do header[0..binaryHeaderSize)
+void storeHeader(unsigned char* header, bool nan, std::size_t n)
+{
+    std::fill(header, header + binaryHeaderSize, 0);
+    header[0] = 'V';
+    header[1] = 'L';
+    header[2] = 'I';
+    header[3] = static_cast<unsigned char> (binaryFormatVersion);
+    header[4] = nan ? flagNaN : 0;
+    const BaseType count = n;
+    storeLittleEndian(header + 8, &count, 1);
+}
+
+//Odczytuje nagłówek, zwraca false dla niepoprawnego; liczbę cyfr zapisuje do n
+bool loadHeader(const unsigned char* header, bool& nan, std::size_t& n)
+{
+    if (header[0] != 'V' || header[1] != 'L' || header[2] != 'I'
+        || header[3] != binaryFormatVersion || (header[4] & ~flagNaN) != 0
+        || header[5] != 0 || header[6] != 0 || header[7] != 0)
+        return false;
+    nan = (header[4] & flagNaN) != 0;
+    BaseType count;
+    loadLittleEndian(&count, header + 8, 1);
+    //Liczba cyfr musi dać się zaadresować (także w bajtach); NaN nie ma cyfr
+    if (count > std::numeric_limits<std::size_t>::max() / limbBytes || (nan && count != 0))
+        return false;
+    n = static_cast<std::size_t> (count);
+    return true;
+}
+
+}
+
+VeryLongIntView::VeryLongIntView(const BaseType* limbs, std::size_t count)
+    : number(LimbStorage::Borrowed(), count == 0 ? &zeroLimb : limbs,
+             count == 0 ? 1 : significantLimbs(limbs, count))
+{
+}
+
+VeryLongIntView::VeryLongIntView(const VeryLongIntView& other)
+    : VeryLongIntView(other.number.storage.data(), other.number.storage.size())
+{
+}
+
+std::size_t limbCount(const VeryLongInt& x)
+{
+    return x.isNaN ? 0 : x.storage.size();
+}
+
+std::size_t toLimbs(const VeryLongInt& x, BaseType* out)
+{
+    if (x.isNaN)
+        return 0;
+    std::copy(x.storage.begin(), x.storage.end(), out);
+    return x.storage.size();
+}
+
+VeryLongInt fromLimbs(const BaseType* limbs, std::size_t count)
+{
+    VeryLongInt result;
+    if (count == 0)
+        return result;
+    const std::size_t n = significantLimbs(limbs, count);
+    result.storage.resize(n);
+    std::copy(limbs, limbs + n, result.storage.data());
+    return result;
+}
+
+std::size_t byteCount(const VeryLongInt& x)
+{
+    if (!x.isValid())
+        return 0;
+    return std::max<std::size_t>((x.numberOfBinaryDigits() + 7) / 8, 1);
+}
+
+std::size_t toBytes(const VeryLongInt& x, unsigned char* out, VeryLongIntByteOrder order)
+{
+    const std::size_t bytes = byteCount(x);
+    if (bytes == 0)
+        return 0;
+    const BaseType* limbs = x.storage.data();
+    for (std::size_t i = 0; i < bytes; i++)
+    {
+        const unsigned char byte = static_cast<unsigned char> (limbs[i / limbBytes] >> (8 * (i % limbBytes)));
+        out[order == VeryLongIntByteOrder::littleEndian ? i : bytes - 1 - i] = byte;
+    }
+    return bytes;
+}
+
+VeryLongInt fromBytes(const unsigned char* bytes, std::size_t count, VeryLongIntByteOrder order)
+{
+    vlikernel::ScratchVector limbs((count + limbBytes - 1) / limbBytes, 0, limbResource());
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const unsigned char byte = bytes[order == VeryLongIntByteOrder::littleEndian ? i : count - 1 - i];
+        limbs[i / limbBytes] |= static_cast<BaseType> (byte) << (8 * (i % limbBytes));
+    }
+    return fromLimbs(limbs.data(), limbs.size());
+}
+
+std::size_t binarySize(const VeryLongInt& x)
+{
+    return binaryHeaderSize + limbCount(x) * limbBytes;
+}
+
+std::size_t writeBinary(const VeryLongInt& x, unsigned char* out)
+{
+    const std::size_t n = limbCount(x);
+    storeHeader(out, x.isNaN, n);
+    if (n > 0)
+        storeLittleEndian(out + binaryHeaderSize, x.storage.data(), n);
+    return binaryHeaderSize + n * limbBytes;
+}
+
+std::size_t readBinary(const unsigned char* data, std::size_t size, VeryLongInt& x)
+{
+    bool nan;
+    std::size_t n;
+    if (size < binaryHeaderSize || !loadHeader(data, nan, n) || n > (size - binaryHeaderSize) / limbBytes)
+    {
+        x = NaN();
+        return 0;
+    }
+    if (nan)
+        x = NaN();
+    else if (n == 0)
+        x = 0;
+    else
+    {
+        x.storage.resize(n);
+        loadLittleEndian(x.storage.data(), data + binaryHeaderSize, n);
+        x.isNaN = false;
+        x.truncate();
+    }
+    return binaryHeaderSize + n * limbBytes;
+}
+
+std::ostream& writeBinary(std::ostream& out, const VeryLongInt& x)
+{
+    const std::size_t n = limbCount(x);
+    unsigned char header[binaryHeaderSize];
+    storeHeader(header, !x.isValid(), n);
+    out.write(reinterpret_cast<const char*> (header), binaryHeaderSize);
+    if (n == 0)
+        return out;
+    if (nativeLittleEndian)
+        out.write(reinterpret_cast<const char*> (x.storage.data()), n * limbBytes);
+    else
+    {
+        std::vector<unsigned char> bytes(n * limbBytes);
+        storeLittleEndian(bytes.data(), x.storage.data(), n);
+        out.write(reinterpret_cast<const char*> (bytes.data()), n * limbBytes);
+    }
+    return out;
+}
+
+std::istream& readBinary(std::istream& in, VeryLongInt& x)
+{
+    unsigned char header[binaryHeaderSize];
+    bool nan;
+    std::size_t n;
+    if (!in.read(reinterpret_cast<char*> (header), binaryHeaderSize) || !loadHeader(header, nan, n))
+    {
+        x = NaN();
+        in.setstate(std::ios_base::failbit);
+        return in;
+    }
+    if (nan)
+    {
+        x = NaN();
+        return in;
+    }
+    if (n == 0)
+    {
+        x = 0;
+        return in;
+    }
+
+    //Cyfry czytane są porcjami, by uszkodzony nagłówek z ogromną liczbą cyfr
+    //nie powodował alokacji ponad rzeczywistą długość danych
+    const std::size_t chunk = 1 << 16;
+    x.storage.clear();
+    x.isNaN = false;
+    std::vector<unsigned char> bytes;
+    for (std::size_t done = 0; done < n; )
+    {
+        const std::size_t part = std::min(chunk, n - done);
+        x.storage.resize(done + part);
+        BaseType* dst = x.storage.data() + done;
+        bool ok;
+        if (nativeLittleEndian)
+            ok = static_cast<bool> (in.read(reinterpret_cast<char*> (dst), part * limbBytes));
+        else
+        {
+            bytes.resize(part * limbBytes);
+            ok = static_cast<bool> (in.read(reinterpret_cast<char*> (bytes.data()), part * limbBytes));
+            loadLittleEndian(dst, bytes.data(), part);
+        }
+        if (!ok)
+        {
+            x = NaN();
+            return in;
+        }
+        done += part;
+    }
+    x.truncate();
+    return in;
+}
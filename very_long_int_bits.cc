@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <utility>
+#include "very_long_int.h"
+#include "very_long_int_kernels.h"
+
+/**
+ * Działania bitowe i operacje na pojedynczych bitach.
+ *
+ * Wszystkie działania wykonywane są całymi cyframi BaseType (pętle bez zależności
+ * między cyframi, wektoryzowane przez kompilator). Wynik & ma co najwyżej tyle cyfr,
+ * co krótszy argument; wyniki | i ^ składają się z cyfr krótszego argumentu
+ * połączonych z cyframi dłuższego oraz skopiowanej reszty dłuższego, więc każda
+ * cyfra wyniku zapisywana jest raz.
+ */
+namespace
+{
+
+const BaseType one = 1;
+
+}
+
+VeryLongInt& VeryLongInt::operator&=(const VeryLongInt& rhs)
+{
+    if (isNaN || rhs.isNaN)
+        return (operator=(NaN()));
+    const std::size_t n = std::min(storage.size(), rhs.storage.size());
+    vlikernel::andN(storage.data(), storage.data(), rhs.storage.data(), n);
+    storage.resize(n);
+    return truncate();
+}
+
+VeryLongInt& VeryLongInt::operator|=(const VeryLongInt& rhs)
+{
+    if (isNaN || rhs.isNaN)
+        return (operator=(NaN()));
+    const std::size_t an = storage.size();
+    const std::size_t bn = rhs.storage.size();
+    if (bn > an)
+    {
+        //rhs jest dłuższy, więc nie jest tym samym obiektem co *this
+        storage.resize(bn);
+        std::copy(rhs.storage.begin() + an, rhs.storage.end(), storage.begin() + an);
+    }
+    vlikernel::orN(storage.data(), storage.data(), rhs.storage.data(), std::min(an, bn));
+    return *this;
+}
+
+VeryLongInt& VeryLongInt::operator^=(const VeryLongInt& rhs)
+{
+    if (isNaN || rhs.isNaN)
+        return (operator=(NaN()));
+    const std::size_t an = storage.size();
+    const std::size_t bn = rhs.storage.size();
+    if (bn > an)
+    {
+        storage.resize(bn);
+        std::copy(rhs.storage.begin() + an, rhs.storage.end(), storage.begin() + an);
+    }
+    vlikernel::xorN(storage.data(), storage.data(), rhs.storage.data(), std::min(an, bn));
+    //Równe najstarsze cyfry znoszą się
+    return truncate();
+}
+
+VeryLongInt operator&(const VeryLongInt& lhs, const VeryLongInt& rhs)
+{
+    if (lhs.isNaN || rhs.isNaN)
+        return NaN();
+    const std::size_t n = std::min(lhs.storage.size(), rhs.storage.size());
+    VeryLongInt result;
+    result.storage.resize(n);
+    vlikernel::andN(result.storage.data(), lhs.storage.data(), rhs.storage.data(), n);
+    result.truncate();
+    return result;
+}
+
+VeryLongInt operator&(VeryLongInt&& lhs, const VeryLongInt& rhs)
+{
+    lhs &= rhs;
+    return std::move(lhs);
+}
+
+VeryLongInt operator&(const VeryLongInt& lhs, VeryLongInt&& rhs)
+{
+    rhs &= lhs;
+    return std::move(rhs);
+}
+
+VeryLongInt operator&(VeryLongInt&& lhs, VeryLongInt&& rhs)
+{
+    lhs &= rhs;
+    return std::move(lhs);
+}
+
+VeryLongInt operator|(const VeryLongInt& lhs, const VeryLongInt& rhs)
+{
+    if (lhs.isNaN || rhs.isNaN)
+        return NaN();
+    const bool lhsLonger = lhs.storage.size() >= rhs.storage.size();
+    const LimbStorage& longer = lhsLonger ? lhs.storage : rhs.storage;
+    const LimbStorage& shorter = lhsLonger ? rhs.storage : lhs.storage;
+    VeryLongInt result;
+    result.storage.resize(longer.size());
+    vlikernel::orN(result.storage.data(), longer.data(), shorter.data(), shorter.size());
+    std::copy(longer.begin() + shorter.size(), longer.end(), result.storage.begin() + shorter.size());
+    return result;
+}
+
+VeryLongInt operator|(VeryLongInt&& lhs, const VeryLongInt& rhs)
+{
+    lhs |= rhs;
+    return std::move(lhs);
+}
+
+VeryLongInt operator|(const VeryLongInt& lhs, VeryLongInt&& rhs)
+{
+    rhs |= lhs;
+    return std::move(rhs);
+}
+
+VeryLongInt operator|(VeryLongInt&& lhs, VeryLongInt&& rhs)
+{
+    lhs |= rhs;
+    return std::move(lhs);
+}
+
+VeryLongInt operator^(const VeryLongInt& lhs, const VeryLongInt& rhs)
+{
+    if (lhs.isNaN || rhs.isNaN)
+        return NaN();
+    const bool lhsLonger = lhs.storage.size() >= rhs.storage.size();
+    const LimbStorage& longer = lhsLonger ? lhs.storage : rhs.storage;
+    const LimbStorage& shorter = lhsLonger ? rhs.storage : lhs.storage;
+    VeryLongInt result;
+    result.storage.resize(longer.size());
+    vlikernel::xorN(result.storage.data(), longer.data(), shorter.data(), shorter.size());
+    std::copy(longer.begin() + shorter.size(), longer.end(), result.storage.begin() + shorter.size());
+    result.truncate();
+    return result;
+}
+
+VeryLongInt operator^(VeryLongInt&& lhs, const VeryLongInt& rhs)
+{
+    lhs ^= rhs;
+    return std::move(lhs);
+}
+
+VeryLongInt operator^(const VeryLongInt& lhs, VeryLongInt&& rhs)
+{
+    rhs ^= lhs;
+    return std::move(rhs);
+}
+
+VeryLongInt operator^(VeryLongInt&& lhs, VeryLongInt&& rhs)
+{
+    lhs ^= rhs;
+    return std::move(lhs);
+}
+
+bool VeryLongInt::testBit(unsigned long long i) const
+{
+    const unsigned long long limb = i / vlikernel::baseBits;
+    if (isNaN || limb >= storage.size())
+        return false;
+    return (storage[limb] >> (i % vlikernel::baseBits)) & 1;
+}
+
+VeryLongInt& VeryLongInt::setBit(unsigned long long i)
+{
+    if (isNaN)
+        return *this;
+    const unsigned long long limb = i / vlikernel::baseBits;
+    if (limb >= storage.size())
+        storage.resize(limb + 1);
+    storage[limb] |= one << (i % vlikernel::baseBits);
+    return *this;
+}
+
+VeryLongInt& VeryLongInt::clearBit(unsigned long long i)
+{
+    const unsigned long long limb = i / vlikernel::baseBits;
+    if (isNaN || limb >= storage.size())
+        return *this;
+    storage[limb] &= ~(one << (i % vlikernel::baseBits));
+    return truncate();
+}
+
+unsigned long long VeryLongInt::popcount() const
+{
+    if (isNaN)
+        return 0;
+    return vlikernel::popcountN(storage.data(), storage.size());
+}
+
+unsigned long long VeryLongInt::countTrailingZeros() const
+{
+    if (isNaN)
+        return 0;
+    const BaseType* p = storage.data();
+    const BaseType* end = p + storage.size();
+    const BaseType* nonzero = std::find_if(p, end, [](BaseType limb) { return limb != 0; });
+    if (nonzero == end)
+        return 0;
+    return static_cast<unsigned long long> (nonzero - p) * vlikernel::baseBits + __builtin_ctzll(*nonzero);
+}
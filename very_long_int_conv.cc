@@ -0,0 +1,414 @@
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "very_long_int_kernels.h"
+
+/**
+ * Konwersje między zapisem binarnym (cyfry BaseType) a dziesiętnym.
+ *
+ * Małe liczby przetwarzane są po 19 cyfr dziesiętnych na raz (10^19 to największa
+ * potęga dziesięciu mieszcząca się w BaseType). Duże liczby dzielone są rekurencyjnie
+ * przez potęgi 10^(19 * 2^k) (wypisywanie) lub składane z połówek mnożeniem przez
+ * te potęgi (wczytywanie), co przy szybkim mnożeniu i dzieleniu daje koszt
+ * O(M(n) log n) zamiast kwadratowego. Tablica potęg jest wspólna dla wszystkich
+ * wywołań i wątków.
+ *
+ * Dla podstaw będących potęgami dwójki każda cyfra zapisu to kolejne bits bitów
+ * liczby, więc konwersje są liniowe i nie wymagają mnożeń ani dzieleń.
+ */
+namespace vlikernel
+{
+
+namespace
+{
+
+const BaseType chunkBase = 10000000000000000000ULL; //10^19
+const std::size_t chunkDigits = 19;
+
+//Liczba cyfr w ap[0..n) bez wiodących zer (co najmniej 1)
+std::size_t normalizedSize(const BaseType* ap, std::size_t n)
+{
+    while (n > 1 && ap[n - 1] == 0)
+        n--;
+    return n;
+}
+
+//Wypisuje wartość x na dokładnie count pozycjach (z wiodącymi zerami), od prawej do lewej
+void writeChunk(char* end, BaseType x, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        *--end = static_cast<char> ('0' + x % 10);
+        x /= 10;
+    }
+}
+
+//Zapisuje ap[0..n) na dokładnie width cyfrach dziesiętnych (z wiodącymi zerami)
+void toDecimalBasecase(char* out, std::size_t width, const BaseType* ap, std::size_t n)
+{
+    ScratchVector tmp(ap, ap + n, limbResource());
+    n = normalizedSize(tmp.data(), n);
+    while (width > 0 && (n > 1 || tmp[0] != 0))
+    {
+        BaseType chunk = divRem1(tmp.data(), tmp.data(), n, chunkBase);
+        n = normalizedSize(tmp.data(), n);
+        std::size_t count = std::min(chunkDigits, width);
+        writeChunk(out + width, chunk, count);
+        width -= count;
+    }
+    std::fill(out, out + width, '0');
+}
+
+void toDecimalRecursive(char* out, std::size_t width, const BaseType* ap, std::size_t n,
+                        std::size_t threshold)
+{
+    n = normalizedSize(ap, n);
+    if (n < threshold)
+    {
+        toDecimalBasecase(out, width, ap, n);
+        return;
+    }
+
+    //Największa potęga 10^(19 * 2^k), której kwadrat nie jest dłuższy niż liczba -
+    //wtedy iloraz i reszta mają podobne rozmiary
+    std::size_t k = 0;
+    while (2 * decimalPower(k + 1).size() <= n + 1)
+        k++;
+    const std::vector<BaseType>& power = decimalPower(k);
+    const std::size_t pn = power.size();
+    const std::size_t lowWidth = chunkDigits << k;
+
+    ScratchVector quotient(n - pn + 1, limbResource());
+    ScratchVector remainder(pn, limbResource());
+    if (pn == 1)
+        remainder[0] = divRem1(quotient.data(), ap, n, power[0]);
+    else
+        divRem(quotient.data(), remainder.data(), ap, n, power.data(), pn);
+
+    toDecimalRecursive(out, width - lowWidth, quotient.data(), quotient.size(), threshold);
+    toDecimalRecursive(out + width - lowWidth, lowWidth, remainder.data(), pn, threshold);
+}
+
+const std::size_t invalidDecimal = static_cast<std::size_t> (-1);
+
+//Wartość count <= 19 cyfr dziesiętnych; false, jeśli napis zawiera inny znak niż cyfra
+bool parseChunk(const char* str, std::size_t count, BaseType& value)
+{
+    BaseType v = 0;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        unsigned digit = static_cast<unsigned char> (str[i]) - static_cast<unsigned> ('0');
+        if (digit > 9)
+            return false;
+        v = v * 10 + digit;
+    }
+    value = v;
+    return true;
+}
+
+//Schemat Hornera po 19 cyfr: wynik = wynik * 10^19 + kolejny kawałek. Pierwszy kawałek
+//jest krótszy, aby pozostałe były pełne. Zwraca liczbę cyfr wyniku bez wiodących zer
+//(0 dla zera) lub invalidDecimal.
+std::size_t fromDecimalBasecase(BaseType* rp, const char* str, std::size_t len)
+{
+    std::size_t first = len % chunkDigits;
+    if (first == 0)
+        first = chunkDigits;
+    BaseType chunk;
+    if (!parseChunk(str, first, chunk))
+        return invalidDecimal;
+
+    std::size_t rn = 0;
+    if (chunk != 0)
+        rp[rn++] = chunk;
+    for (std::size_t position = first; position < len; position += chunkDigits)
+    {
+        if (!parseChunk(str + position, chunkDigits, chunk))
+            return invalidDecimal;
+        BaseType carry = mul1(rp, rp, rn, chunkBase);
+        carry += add1(rp, rp, rn, chunk);
+        if (carry != 0)
+            rp[rn++] = carry;
+    }
+    return rn;
+}
+
+//Wartość = (pierwsze len - L cyfr) * 10^L + (ostatnie L cyfr), L = 19 * 2^k >= len / 2
+std::size_t fromDecimalRecursive(BaseType* rp, const char* str, std::size_t len,
+                                 std::size_t threshold)
+{
+    if (len < threshold * chunkDigits)
+        return fromDecimalBasecase(rp, str, len);
+
+    std::size_t k = 0;
+    while ((chunkDigits << (k + 1)) < len)
+        k++;
+    const std::size_t lowLength = chunkDigits << k;
+    const std::size_t highLength = len - lowLength;
+
+    ScratchVector high(decimalLimbsUpperBound(highLength), limbResource());
+    ScratchVector low(decimalLimbsUpperBound(lowLength), limbResource());
+    std::size_t hn = fromDecimalRecursive(high.data(), str, highLength, threshold);
+    if (hn == invalidDecimal)
+        return invalidDecimal;
+    std::size_t ln = fromDecimalRecursive(low.data(), str + highLength, lowLength, threshold);
+    if (ln == invalidDecimal)
+        return invalidDecimal;
+
+    if (hn == 0)
+    {
+        std::copy(low.begin(), low.begin() + ln, rp);
+        return ln;
+    }
+    const std::vector<BaseType>& power = decimalPower(k);
+    std::size_t rn = power.size() + hn;
+    mul(rp, power.data(), power.size(), high.data(), hn);
+    //low < 10^L, więc ma nie więcej cyfr niż potęga
+    add(rp, rp, rn, low.data(), ln);
+    while (rn > 0 && rp[rn - 1] == 0)
+        rn--;
+    return rn;
+}
+
+}
+
+std::size_t decimalLimbsUpperBound(std::size_t len)
+{
+    //19 cyfr dziesiętnych mieści się w jednej cyfrze BaseType; zapas na iloczyny
+    //w rekurencji, które przed obcięciem zer mogą być o dwie cyfry dłuższe
+    return len / chunkDigits + 3;
+}
+
+std::size_t fromDecimal(BaseType* rp, const char* str, std::size_t len)
+{
+    if (len == 0)
+        return 0;
+    const std::size_t threshold = std::max<std::size_t>(thresholds().decimalParse, 2);
+    std::size_t rn = fromDecimalRecursive(rp, str, len, threshold);
+    if (rn == invalidDecimal)
+        return 0;
+    if (rn == 0)
+    {
+        rp[0] = 0;
+        rn = 1;
+    }
+    return rn;
+}
+
+const std::vector<BaseType>& decimalPower(std::size_t k)
+{
+    //deque nie przenosi istniejących elementów przy dodawaniu nowych,
+    //więc zwrócone referencje pozostają ważne
+    static std::mutex mutex;
+    static std::deque<std::vector<BaseType>> powers;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (powers.empty())
+        powers.push_back(std::vector<BaseType>(1, chunkBase));
+    while (powers.size() <= k)
+    {
+        const std::vector<BaseType>& last = powers.back();
+        std::vector<BaseType> next(2 * last.size());
+        mul(next.data(), last.data(), last.size(), last.data(), last.size());
+        next.resize(normalizedSize(next.data(), next.size()));
+        powers.push_back(std::move(next));
+    }
+    return powers[k];
+}
+
+std::size_t decimalDigitsUpperBound(const BaseType* ap, std::size_t n)
+{
+    n = normalizedSize(ap, n);
+    if (ap[n - 1] == 0)
+        return 1;
+    std::size_t bits = n * baseBits - countLeadingZeros(ap[n - 1]);
+    //Liczba < 2^bits ma co najwyżej floor(bits * log10(2)) + 1 cyfr, a log10(2) < 0.30103
+    return bits * 30103 / 100000 + 1;
+}
+
+std::size_t toDecimal(char* out, const BaseType* ap, std::size_t n)
+{
+    std::size_t width = decimalDigitsUpperBound(ap, n);
+    const std::size_t threshold = std::max<std::size_t>(thresholds().decimalConversion, 2);
+    toDecimalRecursive(out, width, ap, n, threshold);
+
+    //Oszacowanie długości może być nieco za duże - usuwamy wiodące zera
+    std::size_t leading = 0;
+    while (leading + 1 < width && out[leading] == '0')
+        leading++;
+    std::copy(out + leading, out + width, out);
+    return width - leading;
+}
+
+std::size_t radixDigits(const BaseType* ap, std::size_t n, unsigned bits)
+{
+    n = normalizedSize(ap, n);
+    if (ap[n - 1] == 0)
+        return 1;
+    const std::size_t length = n * baseBits - countLeadingZeros(ap[n - 1]);
+    return (length + bits - 1) / bits;
+}
+
+std::size_t toRadix(char* out, const BaseType* ap, std::size_t n, unsigned bits, bool uppercase)
+{
+    const char* symbols = uppercase ? "0123456789ABCDEFGHIJKLMNOPQRSTUV" : "0123456789abcdefghijklmnopqrstuv";
+    const unsigned mask = (1u << bits) - 1;
+    n = normalizedSize(ap, n);
+    const std::size_t digits = radixDigits(ap, n, bits);
+    if (baseBits % bits == 0)
+    {
+        //Każda cyfra BaseType daje stałą liczbę cyfr zapisu; najstarsza - tylko znaczące
+        const std::size_t perLimb = baseBits / bits;
+        char* end = out + digits;
+        for (std::size_t i = 0; i + 1 < n; i++)
+        {
+            BaseType limb = ap[i];
+            char* limbDigits = end - (i + 1) * perLimb;
+            for (std::size_t j = perLimb; j > 0; j--)
+            {
+                limbDigits[j - 1] = symbols[limb & mask];
+                limb >>= bits;
+            }
+        }
+        BaseType top = ap[n - 1];
+        for (std::size_t j = digits - (n - 1) * perLimb; j > 0; j--)
+        {
+            out[j - 1] = symbols[top & mask];
+            top >>= bits;
+        }
+        return digits;
+    }
+    //Cyfry od najmłodszej, zapisywane od końca; w acc czeka accBits bitów liczby,
+    //uzupełnianych kolejną cyfrą BaseType, gdy zabraknie ich na cyfrę zapisu
+    DoubleBaseType acc = 0;
+    unsigned accBits = 0;
+    std::size_t limb = 0;
+    for (std::size_t i = digits; i > 0; i--)
+    {
+        if (accBits < bits)
+        {
+            if (limb < n)
+                acc |= static_cast<DoubleBaseType> (ap[limb++]) << accBits;
+            accBits += baseBits;
+        }
+        out[i - 1] = symbols[static_cast<unsigned> (acc) & mask];
+        acc >>= bits;
+        accBits -= bits;
+    }
+    return digits;
+}
+
+std::size_t radixLimbsUpperBound(std::size_t len, unsigned bits)
+{
+    return (len * bits + baseBits - 1) / baseBits + 1;
+}
+
+namespace
+{
+
+//Wartości znaków jako cyfr w systemach o podstawie do 36 (noDigit dla pozostałych znaków)
+const unsigned char noDigit = 255;
+
+struct DigitTable
+{
+    unsigned char values[256];
+
+    constexpr DigitTable() : values()
+    {
+        for (int c = 0; c < 256; c++)
+            values[c] = noDigit;
+        for (int c = '0'; c <= '9'; c++)
+            values[c] = static_cast<unsigned char> (c - '0');
+        for (int c = 'a'; c <= 'z'; c++)
+            values[c] = static_cast<unsigned char> (c - 'a' + 10);
+        for (int c = 'A'; c <= 'Z'; c++)
+            values[c] = static_cast<unsigned char> (c - 'A' + 10);
+    }
+};
+
+constexpr DigitTable digitTable;
+
+}
+
+int digitValue(char c)
+{
+    const unsigned char value = digitTable.values[static_cast<unsigned char> (c)];
+    return value == noDigit ? -1 : value;
+}
+
+std::size_t digitSpan(const char* str, std::size_t len, unsigned base)
+{
+    std::size_t i = 0;
+    while (i < len && digitTable.values[static_cast<unsigned char> (str[i])] < base)
+        i++;
+    return i;
+}
+
+std::size_t fromRadix(BaseType* rp, const char* str, std::size_t len, unsigned bits)
+{
+    if (len == 0)
+        return 0;
+    //Cyfry od najmłodszej dokładane są do acc; pełne cyfry BaseType trafiają do wyniku.
+    //Poprawność znaków sprawdzana jest raz, na końcu.
+    const unsigned base = 1u << bits;
+    bool invalid = false;
+    if (baseBits % bits == 0)
+    {
+        //Cyfra BaseType składa się z całkowitej liczby cyfr zapisu - składana jest niezależnie
+        //od pozostałych, bez przenoszenia bitów między cyframi
+        const std::size_t perLimb = baseBits / bits;
+        const std::size_t full = len / perLimb;
+        const char* end = str + len;
+        for (std::size_t i = 0; i < full; i++)
+        {
+            const char* digits = end - (i + 1) * perLimb;
+            BaseType limb = 0;
+            unsigned bad = 0;
+            for (std::size_t j = 0; j < perLimb; j++)
+            {
+                const unsigned value = digitTable.values[static_cast<unsigned char> (digits[j])];
+                bad |= value;
+                limb = (limb << bits) | value;
+            }
+            invalid |= bad >= base;
+            rp[i] = limb;
+        }
+        std::size_t n = full;
+        if (len % perLimb != 0)
+        {
+            BaseType limb = 0;
+            for (std::size_t j = 0; j < len % perLimb; j++)
+            {
+                const unsigned value = digitTable.values[static_cast<unsigned char> (str[j])];
+                invalid |= value >= base;
+                limb = (limb << bits) | value;
+            }
+            rp[n++] = limb;
+        }
+        return invalid ? 0 : normalizedSize(rp, n);
+    }
+    DoubleBaseType acc = 0;
+    unsigned accBits = 0;
+    std::size_t n = 0;
+    for (std::size_t i = len; i > 0; i--)
+    {
+        const unsigned value = digitTable.values[static_cast<unsigned char> (str[i - 1])];
+        invalid |= value >= base;
+        acc |= static_cast<DoubleBaseType> (value) << accBits;
+        accBits += bits;
+        if (accBits >= static_cast<unsigned> (baseBits))
+        {
+            rp[n++] = static_cast<BaseType> (acc);
+            acc >>= baseBits;
+            accBits -= baseBits;
+        }
+    }
+    if (invalid)
+        return 0;
+    if (accBits > 0)
+        rp[n++] = static_cast<BaseType> (acc);
+    return normalizedSize(rp, n);
+}
+
+}
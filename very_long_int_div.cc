@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <assert.h>
+#include "very_long_int_kernels.h"
+
+/**
+ * Dzielenie z użyciem odwrotności dzielnika (Möller, Granlund, "Improved division
+ * by invariant integers"): zamiast sprzętowego dzielenia 128/64 dla każdej cyfry
+ * ilorazu wykonywane są dwa mnożenia przez wcześniej wyznaczoną odwrotność
+ * najstarszej cyfry (lub dwóch najstarszych cyfr) znormalizowanego dzielnika.
+ */
+namespace vlikernel
+{
+
+BaseType reciprocal2by1(BaseType d)
+{
+    //floor((B^2 - 1) / d) - B = floor(((B - 1 - d) * B + (B - 1)) / d)
+    DoubleBaseType num = (static_cast<DoubleBaseType> (~d) << baseBits) | ~static_cast<BaseType> (0);
+    return static_cast<BaseType> (num / d);
+}
+
+BaseType reciprocal3by2(BaseType d1, BaseType d0)
+{
+    BaseType v = reciprocal2by1(d1);
+    BaseType p = d1 * v + d0;
+    if (p < d0)
+    {
+        v--;
+        if (p >= d1)
+        {
+            v--;
+            p -= d1;
+        }
+        p -= d1;
+    }
+    DoubleBaseType t = static_cast<DoubleBaseType> (v) * d0;
+    BaseType t1 = static_cast<BaseType> (t >> baseBits);
+    BaseType t0 = static_cast<BaseType> (t);
+    p += t1;
+    if (p < t1)
+    {
+        v--;
+        if (p > d1 || (p == d1 && t0 >= d0))
+            v--;
+    }
+    return v;
+}
+
+namespace
+{
+
+//Iloraz (u1, u0) / d dla znormalizowanego d i u1 < d; reszta do r
+inline BaseType div2by1(BaseType u1, BaseType u0, BaseType d, BaseType v, BaseType& r)
+{
+    DoubleBaseType qq = static_cast<DoubleBaseType> (u1) * v
+                        + ((static_cast<DoubleBaseType> (u1 + 1) << baseBits) | u0);
+    BaseType q1 = static_cast<BaseType> (qq >> baseBits);
+    BaseType q0 = static_cast<BaseType> (qq);
+    BaseType rem = u0 - q1 * d;
+    if (rem > q0)
+    {
+        q1--;
+        rem += d;
+    }
+    if (rem >= d)
+    {
+        q1++;
+        rem -= d;
+    }
+    r = rem;
+    return q1;
+}
+
+//Iloraz (n2, n1, n0) / (d1, d0) dla znormalizowanego d1 i (n2, n1) < (d1, d0)
+inline BaseType div3by2(BaseType n2, BaseType n1, BaseType n0, BaseType d1, BaseType d0, BaseType v)
+{
+    DoubleBaseType qq = static_cast<DoubleBaseType> (n2) * v
+                        + ((static_cast<DoubleBaseType> (n2) << baseBits) | n1);
+    BaseType q = static_cast<BaseType> (qq >> baseBits);
+    BaseType q0 = static_cast<BaseType> (qq);
+    const DoubleBaseType d = (static_cast<DoubleBaseType> (d1) << baseBits) | d0;
+    BaseType r1 = n1 - d1 * q;
+    DoubleBaseType r = ((static_cast<DoubleBaseType> (r1) << baseBits) | n0) - d;
+    r -= static_cast<DoubleBaseType> (d0) * q;
+    q++;
+    if (static_cast<BaseType> (r >> baseBits) >= q0)
+    {
+        q--;
+        r += d;
+    }
+    if (r >= d)
+        q++;
+    return q;
+}
+
+}
+
+BaseType divRem1Preinv(BaseType* qp, const BaseType* ap, std::size_t n,
+                       BaseType d, unsigned shift, BaseType v)
+{
+    //Dzielna przesuwana jest o shift bitów "w locie" - iloraz się nie zmienia,
+    //a reszta jest przesunięta o shift bitów
+    BaseType r = (shift == 0) ? 0 : ap[n - 1] >> (baseBits - shift);
+    for (std::size_t i = n; i > 0; i--)
+    {
+        BaseType limb = ap[i - 1] << shift;
+        if (shift != 0 && i > 1)
+            limb |= ap[i - 2] >> (baseBits - shift);
+        BaseType q = div2by1(r, limb, d, v, r);
+        if (qp != nullptr)
+            qp[i - 1] = q;
+    }
+    return r >> shift;
+}
+
+BaseType divRem1(BaseType* qp, const BaseType* ap, std::size_t n, BaseType d)
+{
+    assert(d != 0);
+    //Wyznaczenie odwrotności kosztuje jedno dzielenie sprzętowe - opłaca się od kilku cyfr
+    if (n >= 3)
+    {
+        unsigned shift = countLeadingZeros(d);
+        d <<= shift;
+        return divRem1Preinv(qp, ap, n, d, shift, reciprocal2by1(d));
+    }
+    BaseType r = 0;
+    //r < d, więc (r, a) / d mieści się w jednej cyfrze i dzielenie 128/64 nie przepełnia się
+    for (std::size_t i = n; i > 0; i--)
+    {
+        DoubleBaseType num = (static_cast<DoubleBaseType> (r) << baseBits) | ap[i - 1];
+        BaseType q = static_cast<BaseType> (num / d);
+        r = static_cast<BaseType> (num - static_cast<DoubleBaseType> (q) * d);
+        if (qp != nullptr)
+            qp[i - 1] = q;
+    }
+    return r;
+}
+
+namespace
+{
+
+//Dzielenie pisemne (algorytm D Knutha) dla znormalizowanego dzielnika (najstarszy bit
+//dp[dn - 1] ustawiony), dn >= 2, wykonywane w miejscu: np[0..nn) dzielone jest przez dp,
+//iloraz trafia do qp[0..nn - dn), a reszta do np[0..dn). v = reciprocal3by2 dwóch
+//najstarszych cyfr dzielnika.
+//Jeśli najstarsze dn cyfr np nie jest mniejsze od dp, odejmowane jest dp
+//i zwracana jest dodatkowa najstarsza cyfra ilorazu równa 1.
+BaseType divSchoolNormalized(BaseType* qp, BaseType* np, std::size_t nn,
+                             const BaseType* dp, std::size_t dn, BaseType v)
+{
+    BaseType qh = 0;
+    if (compareN(np + nn - dn, dp, dn) >= 0)
+    {
+        subN(np + nn - dn, np + nn - dn, dp, dn);
+        qh = 1;
+    }
+
+    const BaseType vTop = dp[dn - 1];
+    const BaseType vNext = dp[dn - 2];
+    for (std::size_t j = nn - dn; j > 0; j--)
+    {
+        BaseType* u = np + j - 1;
+        //Cyfra ilorazu wyznaczona z trzech najstarszych cyfr reszty i dwóch najstarszych
+        //cyfr dzielnika jest co najwyżej o 1 za duża. Gdy (u[dn], u[dn - 1]) jest równe
+        //tym cyfrom dzielnika, iloraz 3/2 nie mieści się w cyfrze, a B - 1 jest dobrym
+        //oszacowaniem.
+        BaseType q;
+        if (u[dn] == vTop && u[dn - 1] == vNext)
+            q = ~static_cast<BaseType> (0);
+        else
+            q = div3by2(u[dn], u[dn - 1], u[dn - 2], vTop, vNext, v);
+
+        BaseType borrow = subMul1(u, dp, dn, q);
+        BaseType top = u[dn];
+        u[dn] = top - borrow;
+        if (top < borrow)
+        {
+            //Rzadki przypadek: oszacowanie o 1 za duże, dodajemy dzielnik z powrotem
+            q--;
+            u[dn] += addN(u, u, dp, dn);
+        }
+        qp[j - 1] = q;
+    }
+    return qh;
+}
+
+//Dzielenie rekurencyjne Burnikela-Zieglera: np[0..n + k) dzielone przez znormalizowane
+//dp[0..n), k <= n cyfr ilorazu do qp[0..k), reszta w np[0..n). Konwencja najstarszej
+//cyfry ilorazu (zwracanej) jak w divSchoolNormalized. tp - bufor pomocniczy na 3n cyfr.
+//Wszystkie dzielniki w rekurencji mają te same dwie najstarsze cyfry, więc v jest wspólne.
+BaseType divRecursive(BaseType* qp, BaseType* np, const BaseType* dp, std::size_t n,
+                      std::size_t k, std::size_t threshold, BaseType v, BaseType* tp)
+{
+    if (k < threshold || n < threshold)
+        return divSchoolNormalized(qp, np, n + k, dp, n, v);
+
+    if (k == n)
+    {
+        //Dzielenie 2n / n rozkładamy na dwa dzielenia (n + n/2) / n
+        const std::size_t lo = n / 2;
+        const std::size_t hi = n - lo;
+        BaseType qh = divRecursive(qp + lo, np + lo, dp, n, hi, threshold, v, tp);
+        BaseType ql = divRecursive(qp, np, dp, n, lo, threshold, v, tp);
+        assert(ql == 0);
+        (void) ql;
+        return qh;
+    }
+
+    //Cyfry ilorazu wyznaczamy z najstarszych k cyfr dzielnika (dzielenie 2k / k), a następnie
+    //odejmujemy iloczyn ilorazu i pozostałych n - k cyfr dzielnika. Ponieważ dzielnik jest
+    //znormalizowany, tak otrzymany iloraz jest za duży co najwyżej o 2.
+    BaseType qh = divRecursive(qp, np + n - k, dp + n - k, k, k, threshold, v, tp + n);
+    mul(tp, qp, k, dp, n - k);
+    BaseType borrow = subN(np, np, tp, n);
+    if (qh != 0)
+        borrow += subN(np + k, np + k, dp, n - k);
+    while (borrow != 0)
+    {
+        qh -= sub1(qp, qp, k, 1);
+        borrow -= addN(np, np, dp, n);
+    }
+    return qh;
+}
+
+}
+
+void divRemNormalized(BaseType* qp, BaseType* rp, const BaseType* ap, std::size_t an,
+                      const BaseType* vp, std::size_t dn, unsigned shift, BaseType v)
+{
+    assert(dn >= 2 && an >= dn && (vp[dn - 1] >> (baseBits - 1)) == 1);
+    const std::size_t qn = an + 1 - dn;
+
+    //Dzielna dostaje dodatkową cyfrę na wysunięte bity; jej najstarsze dn cyfr jest
+    //mniejsze od dzielnika, więc iloraz ma dokładnie an + 1 - dn cyfr.
+    ScratchVector buffer(an + 1 + (qp == nullptr ? qn : 0), limbResource());
+    BaseType* un = buffer.data();
+    if (qp == nullptr)
+        qp = un + an + 1;
+    if (shift > 0)
+        un[an] = lshift(un, ap, an, shift);
+    else
+    {
+        std::copy(ap, ap + an, un);
+        un[an] = 0;
+    }
+
+    const std::size_t threshold = std::max<std::size_t>(thresholds().divideAndConquerDiv, 4);
+    if (dn < threshold || qn < threshold)
+        divSchoolNormalized(qp, un, an + 1, vp, dn, v);
+    else
+    {
+        //Dzielenie blokami po dn cyfr ilorazu (jak dzielenie pisemne o podstawie B^dn),
+        //każdy blok rekurencyjnie; najpierw niepełny blok najstarszych cyfr
+        ScratchVector tp(3 * dn, limbResource());
+        std::size_t position = qn - qn % dn;
+        if (position < qn)
+            divRecursive(qp + position, un + position, vp, dn, qn - position, threshold, v, tp.data());
+        while (position > 0)
+        {
+            position -= dn;
+            divRecursive(qp + position, un + position, vp, dn, dn, threshold, v, tp.data());
+        }
+    }
+
+    if (rp != nullptr)
+    {
+        if (shift > 0)
+            rshift(rp, un, dn, shift);
+        else
+            std::copy(un, un + dn, rp);
+    }
+}
+
+void divRem(BaseType* qp, BaseType* rp, const BaseType* ap, std::size_t an,
+            const BaseType* dp, std::size_t dn)
+{
+    assert(dn >= 2 && an >= dn && dp[dn - 1] != 0);
+
+    //Normalizacja: przesuwamy dzielnik tak, by jego najstarszy bit był ustawiony.
+    //Wtedy oszacowanie cyfry ilorazu z najstarszych cyfr jest co najwyżej o 1 za duże.
+    ScratchVector vn(dn, limbResource());
+    unsigned shift = countLeadingZeros(dp[dn - 1]);
+    if (shift > 0)
+        lshift(vn.data(), dp, dn, shift);
+    else
+        std::copy(dp, dp + dn, vn.data());
+    divRemNormalized(qp, rp, ap, an, vn.data(), dn, shift, reciprocal3by2(vn[dn - 1], vn[dn - 2]));
+}
+
+}
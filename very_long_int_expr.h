@@ -0,0 +1,240 @@
+#ifndef VERY_LONG_INT_EXPR_H
+#define VERY_LONG_INT_EXPR_H
+
+#include <type_traits>
+#include <utility>
+#include "very_long_int.h"
+
+/**
+ * Opcjonalna warstwa wyrażeń leniwych (expression templates).
+ *
+ * Wyrażenie zaczynające się od lazy(x), np. lazy(a) * b + c albo (lazy(a) + b) % m,
+ * niczego nie liczy - buduje drzewo, które obliczane jest dopiero przy zamianie
+ * na VeryLongInt (VeryLongInt r = ...;) lub w assign(r, ...), od razu do liczby
+ * docelowej: iloczyn dwóch liczb trafia wprost do jej bufora, a kolejne działania
+ * wykonywane są w miejscu (a * b + c * d dodaje drugi iloczyn bez tworzenia liczby
+ * pośredniej). assign() używa ponownie bufora liczby docelowej. Liczby tymczasowe
+ * powstają tylko dla złożonych prawych argumentów -, /, % oraz gdy liczba docelowa
+ * występuje w wyrażeniu.
+ *
+ * Drzewo przechowuje referencje do argumentów, więc trzeba je obliczyć w tej samej
+ * instrukcji, w której powstało (nie zapisywać go w zmiennej auto).
+ */
+namespace vliexpr
+{
+
+struct Add {};
+struct Sub {};
+struct Mul {};
+struct Div {};
+struct Mod {};
+
+//Liść drzewa - referencja do istniejącej liczby
+class Leaf
+{
+public:
+    explicit Leaf(const VeryLongInt& number) : number(number) {}
+
+    bool refersTo(const VeryLongInt* p) const { return &number == p; }
+
+    const VeryLongInt& number;
+};
+
+template<class Op, class L, class R>
+class Binary
+{
+public:
+    Binary(const L& lhs, const R& rhs) : lhs(lhs), rhs(rhs) {}
+
+    bool refersTo(const VeryLongInt* p) const { return lhs.refersTo(p) || rhs.refersTo(p); }
+
+    operator VeryLongInt() const;
+
+    L lhs;
+    R rhs;
+};
+
+template<class T>
+struct IsNode : std::false_type {};
+template<>
+struct IsNode<Leaf> : std::true_type {};
+template<class Op, class L, class R>
+struct IsNode<Binary<Op, L, R>> : std::true_type {};
+
+//Typ węzła odpowiadający argumentowi operatora: VeryLongInt staje się liściem
+template<class T>
+struct NodeOf { typedef T type; };
+template<>
+struct NodeOf<VeryLongInt> { typedef Leaf type; };
+
+inline Leaf toNode(const VeryLongInt& x) { return Leaf(x); }
+template<class E>
+const E& toNode(const E& e) { return e; }
+
+struct Evaluator
+{
+    //dest = e
+    template<class E>
+    static void assign(VeryLongInt& dest, const E& e)
+    {
+        if (e.refersTo(&dest))
+        {
+            //Liczba docelowa jest też argumentem - liczymy do osobnej liczby
+            VeryLongInt result;
+            evaluate(result, e);
+            dest = std::move(result);
+        }
+        else
+            evaluate(dest, e);
+    }
+
+private:
+    //W funkcjach evaluate i accumulate dest nie występuje w wyrażeniu
+
+    static const VeryLongInt& value(const Leaf& e) { return e.number; }
+    template<class E>
+    static VeryLongInt value(const E& e) { return VeryLongInt(e); }
+
+    static void evaluate(VeryLongInt& dest, const Leaf& e)
+    {
+        dest = e.number;
+    }
+
+    template<class L, class R>
+    static void evaluate(VeryLongInt& dest, const Binary<Add, L, R>& e)
+    {
+        //Dodawanie jest przemienne - najpierw liczymy bardziej złożony argument
+        if constexpr (std::is_same<L, Leaf>::value && !std::is_same<R, Leaf>::value)
+        {
+            evaluate(dest, e.rhs);
+            dest += e.lhs.number;
+        }
+        else
+        {
+            evaluate(dest, e.lhs);
+            accumulate(dest, e.rhs);
+        }
+    }
+
+    template<class L, class R>
+    static void evaluate(VeryLongInt& dest, const Binary<Sub, L, R>& e)
+    {
+        evaluate(dest, e.lhs);
+        dest -= value(e.rhs);
+    }
+
+    template<class L, class R>
+    static void evaluate(VeryLongInt& dest, const Binary<Mul, L, R>& e)
+    {
+        if constexpr (std::is_same<L, Leaf>::value && std::is_same<R, Leaf>::value)
+            dest.assignProduct(e.lhs.number, e.rhs.number);
+        else if constexpr (std::is_same<L, Leaf>::value)
+        {
+            evaluate(dest, e.rhs);
+            dest *= e.lhs.number;
+        }
+        else
+        {
+            evaluate(dest, e.lhs);
+            dest *= value(e.rhs);
+        }
+    }
+
+    template<class L, class R>
+    static void evaluate(VeryLongInt& dest, const Binary<Div, L, R>& e)
+    {
+        evaluate(dest, e.lhs);
+        dest /= value(e.rhs);
+    }
+
+    template<class L, class R>
+    static void evaluate(VeryLongInt& dest, const Binary<Mod, L, R>& e)
+    {
+        evaluate(dest, e.lhs);
+        dest %= value(e.rhs);
+    }
+
+    //dest += e
+    static void accumulate(VeryLongInt& dest, const Leaf& e)
+    {
+        dest += e.number;
+    }
+
+    template<class L, class R>
+    static void accumulate(VeryLongInt& dest, const Binary<Mul, L, R>& e)
+    {
+        dest.addProduct(value(e.lhs), value(e.rhs));
+    }
+
+    template<class E>
+    static void accumulate(VeryLongInt& dest, const E& e)
+    {
+        dest += value(e);
+    }
+};
+
+template<class Op, class L, class R>
+Binary<Op, L, R>::operator VeryLongInt() const
+{
+    VeryLongInt result;
+    Evaluator::assign(result, *this);
+    return result;
+}
+
+//Początek wyrażenia leniwego
+inline Leaf lazy(const VeryLongInt& x)
+{
+    return Leaf(x);
+}
+
+//dest = e, z użyciem bufora dest
+template<class E, class = typename std::enable_if<IsNode<E>::value>::type>
+void assign(VeryLongInt& dest, const E& e)
+{
+    Evaluator::assign(dest, e);
+}
+
+//Operatory budujące drzewo; co najmniej jeden argument musi być już węzłem,
+//aby zwykłe działania na VeryLongInt pozostały natychmiastowe
+template<class L, class R>
+using EnableForNodes = typename std::enable_if<
+    (IsNode<L>::value || IsNode<R>::value)
+    && (IsNode<L>::value || std::is_same<L, VeryLongInt>::value)
+    && (IsNode<R>::value || std::is_same<R, VeryLongInt>::value)>::type;
+
+template<class Op, class L, class R>
+using BinaryOf = Binary<Op, typename NodeOf<L>::type, typename NodeOf<R>::type>;
+
+template<class L, class R, class = EnableForNodes<L, R>>
+BinaryOf<Add, L, R> operator+(const L& lhs, const R& rhs)
+{
+    return BinaryOf<Add, L, R>(toNode(lhs), toNode(rhs));
+}
+
+template<class L, class R, class = EnableForNodes<L, R>>
+BinaryOf<Sub, L, R> operator-(const L& lhs, const R& rhs)
+{
+    return BinaryOf<Sub, L, R>(toNode(lhs), toNode(rhs));
+}
+
+template<class L, class R, class = EnableForNodes<L, R>>
+BinaryOf<Mul, L, R> operator*(const L& lhs, const R& rhs)
+{
+    return BinaryOf<Mul, L, R>(toNode(lhs), toNode(rhs));
+}
+
+template<class L, class R, class = EnableForNodes<L, R>>
+BinaryOf<Div, L, R> operator/(const L& lhs, const R& rhs)
+{
+    return BinaryOf<Div, L, R>(toNode(lhs), toNode(rhs));
+}
+
+template<class L, class R, class = EnableForNodes<L, R>>
+BinaryOf<Mod, L, R> operator%(const L& lhs, const R& rhs)
+{
+    return BinaryOf<Mod, L, R>(toNode(lhs), toNode(rhs));
+}
+
+}
+
+#endif
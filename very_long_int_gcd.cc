@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <assert.h>
+#include <utility>
+#include "very_long_int.h"
+#include "very_long_int_kernels.h"
+
+/**
+ * Największy wspólny dzielnik algorytmem Lehmera (Knuth, TAOCP t. 2, 4.5.2, algorytm L)
+ * z krokami na podwójnych cyfrach: kolejne ilorazy algorytmu Euklidesa wyznaczane są
+ * z najstarszych 125 bitów argumentów, dopóki nie ma pewności, że są takie same jak dla
+ * pełnych liczb. Uzyskana macierz o współczynnikach jednocyfrowych (około 60 bitów
+ * postępu) stosowana jest do pełnych liczb w czterech przejściach po cyfrach, zamiast
+ * kilkudziesięciu dzieleń. Gdy iloraz jest zbyt duży, by wyznaczyć go z najstarszych
+ * cyfr, wykonywany jest zwykły krok dzielenia.
+ *
+ * Współczynniki Bézout kolejnych reszt mają naprzemienne znaki, więc ich wartości
+ * bezwzględne są sumami iloczynów (bez odejmowania), a znak wynika z parzystości
+ * liczby wykonanych kroków.
+ */
+namespace
+{
+
+using vlikernel::DoubleBaseType;
+using vlikernel::baseBits;
+
+unsigned trailingZeros(DoubleBaseType x)
+{
+    const BaseType low = static_cast<BaseType> (x);
+    if (low != 0)
+        return __builtin_ctzll(low);
+    return baseBits + __builtin_ctzll(static_cast<BaseType> (x >> baseBits));
+}
+
+//Algorytm binarny (Steina) dla liczb mieszczących się w dwóch cyfrach
+DoubleBaseType binaryGcd(DoubleBaseType a, DoubleBaseType b)
+{
+    if (a == 0)
+        return b;
+    if (b == 0)
+        return a;
+    const unsigned k = trailingZeros(a | b);
+    a >>= trailingZeros(a);
+    do
+    {
+        b >>= trailingZeros(b);
+        if (a > b)
+            std::swap(a, b);
+        b -= a;
+    }
+    while (b != 0);
+    return a << k;
+}
+
+std::size_t normalizedSize(const BaseType* p, std::size_t n)
+{
+    while (n > 0 && p[n - 1] == 0)
+        n--;
+    return n;
+}
+
+//Najstarsze 125 bitów p[0..n) po przesunięciu o shift bitów w lewo
+//(dla n < 3 brakujące cyfry traktowane są jak zera)
+DoubleBaseType leadingBits(const BaseType* p, std::size_t n, unsigned shift)
+{
+    const BaseType p1 = n >= 2 ? p[n - 2] : 0;
+    const BaseType p2 = n >= 3 ? p[n - 3] : 0;
+    DoubleBaseType top = (static_cast<DoubleBaseType> (p[n - 1]) << baseBits) | p1;
+    if (shift > 0)
+        top = (top << shift) | (p2 >> (baseBits - shift));
+    return top >> 3;
+}
+
+//floor(n / d) dla n >= 0, d > 0; małe ilorazy (najczęstsze w algorytmie Euklidesa)
+//wyznaczane są odejmowaniem, bez kosztownego dzielenia 128-bitowego
+__int128 smallQuotient(__int128 n, __int128 d)
+{
+    __int128 q = 0;
+    while (n >= d && q < 4)
+    {
+        n -= d;
+        q++;
+    }
+    if (n >= d)
+        q += n / d;
+    return q;
+}
+
+//Wynik kroku Lehmera po steps krokach algorytmu Euklidesa: nowe a = s0 a + t0 b,
+//nowe b = s1 a + t1 b. Pola zawierają wartości bezwzględne; dla parzystego steps
+//ujemne są t0 i s1, dla nieparzystego s0 i t1.
+struct LehmerMatrix
+{
+    BaseType s0, t0, s1, t1;
+    unsigned long long steps;
+};
+
+//Symuluje algorytm Euklidesa na najstarszych cyfrach u, v. Iloraz jest przyjmowany
+//tylko wtedy, gdy jest taki sam dla obu granic przedziału zawierającego a / b.
+//Zwraca false, jeśli nie udało się wykonać żadnego kroku.
+bool lehmerMatrix(DoubleBaseType u, DoubleBaseType v, LehmerMatrix& m)
+{
+    typedef __int128 SignedType;
+    const SignedType limit = (static_cast<SignedType> (1) << (baseBits - 1)) - 1;
+    SignedType a = 1, b = 0, c = 0, d = 1;
+    SignedType x = u, y = v;
+    unsigned long long steps = 0;
+    for (;;)
+    {
+        if (y + c <= 0 || y + d <= 0 || x + a < 0 || x + b < 0)
+            break;
+        const SignedType q = smallQuotient(x + a, y + c);
+        if (q != smallQuotient(x + b, y + d))
+            break;
+        //Znaki a i c (oraz b i d) są przeciwne, więc |a - q c| = |a| + q |c|
+        const SignedType absA = a < 0 ? -a : a, absB = b < 0 ? -b : b;
+        const SignedType absC = c < 0 ? -c : c, absD = d < 0 ? -d : d;
+        //Dla q <= limit iloczyny mieszczą się w 127 bitach
+        if (q > limit || absA + q * absC > limit || absB + q * absD > limit)
+            break;
+        SignedType t = a - q * c;
+        a = c;
+        c = t;
+        t = b - q * d;
+        b = d;
+        d = t;
+        t = x - q * y;
+        x = y;
+        y = t;
+        steps++;
+    }
+    if (steps == 0)
+        return false;
+    m.s0 = static_cast<BaseType> (a < 0 ? -a : a);
+    m.t0 = static_cast<BaseType> (b < 0 ? -b : b);
+    m.s1 = static_cast<BaseType> (c < 0 ? -c : c);
+    m.t1 = static_cast<BaseType> (d < 0 ? -d : d);
+    m.steps = steps;
+    return true;
+}
+
+//rp[0..n) = x * xp[0..n) - y * yp[0..n), wynik musi być nieujemny i mniejszy od B^n
+void combineDifference(BaseType* rp, const BaseType* xp, BaseType x,
+                       const BaseType* yp, BaseType y, std::size_t n)
+{
+    BaseType high = vlikernel::mul1(rp, xp, n, x);
+    high -= vlikernel::subMul1(rp, yp, n, y);
+    assert(high == 0);
+    (void) high;
+}
+
+//rp[0..n] = x * xp[0..n) + y * yp[0..n)
+void combineSum(BaseType* rp, const BaseType* xp, BaseType x,
+                const BaseType* yp, BaseType y, std::size_t n)
+{
+    rp[n] = vlikernel::mul1(rp, xp, n, x);
+    rp[n] += vlikernel::addMul1(rp, yp, n, y);
+}
+
+}
+
+void VeryLongInt::performGcd(const VeryLongInt& a, const VeryLongInt& b, VeryLongInt& result,
+                             VeryLongInt* cofactor, bool* cofactorNegative)
+{
+    assert(!a.isNaN && !b.isNaN && a >= b && b != 0);
+    const bool extended = (cofactor != nullptr);
+    const std::size_t n = a.storage.size();
+
+    //Bieżące reszty x >= y i bufory na następne; cyfry y od yn do xn są zerami
+    //(najstarsze cyfry y czytane są na pozycjach cyfr x)
+    vlikernel::ScratchVector buffer(4 * n, limbResource());
+    BaseType* x = buffer.data();
+    BaseType* y = x + n;
+    BaseType* nextX = y + n;
+    BaseType* nextY = nextX + n;
+    std::copy(a.storage.begin(), a.storage.end(), x);
+    std::copy(b.storage.begin(), b.storage.end(), y);
+    std::fill(y + b.storage.size(), y + n, 0);
+    std::size_t xn = n;
+    std::size_t yn = b.storage.size();
+
+    //Wersja rozszerzona: wartości bezwzględne współczynników przy b w wyrażeniu reszt
+    //x = s a + u b i y = r a + w b. Nie przekraczają a, więc mieszczą się w n cyfrach;
+    //obie zapisane są na un cyfrach. negative - znak u (dla x = a współczynnik jest
+    //zerem, a znak dobrany tak, by po pierwszym kroku był poprawny).
+    const std::size_t cn = extended ? n + 2 : 0;
+    vlikernel::ScratchVector cofactors(4 * cn + (extended ? n : 0), limbResource());
+    BaseType* u = cofactors.data();
+    BaseType* w = u + cn;
+    BaseType* nextU = w + cn;
+    BaseType* nextW = nextU + cn;
+    BaseType* quotient = nextW + cn;
+    std::size_t un = 1;
+    bool negative = true;
+    if (extended)
+    {
+        u[0] = 0;
+        w[0] = 1;
+    }
+
+    while (yn > 0)
+    {
+        if (!extended && xn <= 2)
+        {
+            //Końcówka algorytmem binarnym na podwójnej cyfrze
+            DoubleBaseType p = x[0], q = y[0];
+            if (xn == 2)
+            {
+                p |= static_cast<DoubleBaseType> (x[1]) << baseBits;
+                q |= static_cast<DoubleBaseType> (y[1]) << baseBits;
+            }
+            DoubleBaseType g = binaryGcd(p, q);
+            x[0] = static_cast<BaseType> (g);
+            xn = 1;
+            if ((g >> baseBits) != 0)
+            {
+                x[1] = static_cast<BaseType> (g >> baseBits);
+                xn = 2;
+            }
+            break;
+        }
+
+        LehmerMatrix m;
+        const unsigned shift = vlikernel::countLeadingZeros(x[xn - 1]);
+        if (lehmerMatrix(leadingBits(x, xn, shift), leadingBits(y, xn, shift), m))
+        {
+            if (m.steps % 2 == 0)
+            {
+                combineDifference(nextX, x, m.s0, y, m.t0, xn);
+                combineDifference(nextY, y, m.t1, x, m.s1, xn);
+            }
+            else
+            {
+                combineDifference(nextX, y, m.t0, x, m.s0, xn);
+                combineDifference(nextY, x, m.s1, y, m.t1, xn);
+            }
+            std::swap(x, nextX);
+            std::swap(y, nextY);
+            yn = normalizedSize(y, xn);
+            xn = normalizedSize(x, xn);
+            if (extended)
+            {
+                combineSum(nextU, u, m.s0, w, m.t0, un);
+                combineSum(nextW, u, m.s1, w, m.t1, un);
+                std::swap(u, nextU);
+                std::swap(w, nextW);
+                un = std::max(normalizedSize(u, un + 1), normalizedSize(w, un + 1));
+                negative ^= (m.steps % 2 == 1);
+            }
+            continue;
+        }
+
+        //Krok dzielenia: (x, y) = (y, x mod y)
+        const std::size_t qn = xn - yn + 1;
+        if (yn == 1)
+            nextY[0] = vlikernel::divRem1(extended ? quotient : nullptr, x, xn, y[0]);
+        else
+            vlikernel::divRem(extended ? quotient : nullptr, nextY, x, xn, y, yn);
+        std::swap(x, y);
+        std::swap(y, nextY);
+        xn = yn;
+        yn = normalizedSize(y, xn);
+        if (extended)
+        {
+            //Nowy współczynnik przy y: u + q w; nowy przy x: w
+            const std::size_t wn = normalizedSize(w, un);
+            const std::size_t ql = normalizedSize(quotient, qn);
+            const std::size_t length = std::max(un, ql + wn) + 1;
+            std::copy(u, u + un, nextW);
+            std::fill(nextW + un, nextW + length, 0);
+            if (wn > 0)
+            {
+                vlikernel::mul(nextU, quotient, ql, w, wn);
+                vlikernel::add(nextW, nextW, length, nextU, ql + wn);
+            }
+            std::swap(u, w);
+            std::swap(w, nextW);
+            const std::size_t newUn = std::max(un, normalizedSize(w, length));
+            std::fill(u + un, u + newUn, 0);
+            un = newUn;
+            negative = !negative;
+        }
+    }
+
+    result.storage.resize(xn);
+    std::copy(x, x + xn, result.storage.data());
+    result.isNaN = false;
+    if (extended)
+    {
+        const std::size_t length = normalizedSize(u, un);
+        cofactor->storage.resize(length);
+        std::copy(u, u + length, cofactor->storage.data());
+        cofactor->isNaN = false;
+        *cofactorNegative = negative;
+    }
+}
+
+VeryLongInt gcd(const VeryLongInt& a, const VeryLongInt& b)
+{
+    if (a.isNaN || b.isNaN)
+        return NaN();
+    if (a == 0)
+        return b;
+    if (b == 0)
+        return a;
+
+    //gcd(a, b) = 2^min(i, j) gcd(a / 2^i, b / 2^j) dla i, j - liczby zer na końcu a i b
+    const unsigned long long i = a.countTrailingZeros();
+    const unsigned long long j = b.countTrailingZeros();
+    VeryLongInt oddA = a >> i;
+    VeryLongInt oddB = b >> j;
+    if (oddA < oddB)
+        oddA.storage.swap(oddB.storage);
+    VeryLongInt result;
+    if (oddB == 1)
+        result = 1;
+    else
+        VeryLongInt::performGcd(oddA, oddB, result, nullptr, nullptr);
+    result <<= std::min(i, j);
+    return result;
+}
+
+VeryLongIntBezout extendedGcd(const VeryLongInt& a, const VeryLongInt& b)
+{
+    VeryLongIntBezout r;
+    r.xNegative = false;
+    if (a.isNaN || b.isNaN)
+    {
+        r.gcd = r.x = r.y = NaN();
+        return r;
+    }
+    if (a < b)
+    {
+        //gcd = x b - y a  <=>  gcd = y a - x b po zamianie ról
+        r = extendedGcd(b, a);
+        std::swap(r.x, r.y);
+        r.xNegative = !r.xNegative;
+        return r;
+    }
+    if (b == 0)
+    {
+        //gcd(a, 0) = a = 1 * a - 0 * 0 (dla a = 0 wszystko jest zerem)
+        r.gcd = a;
+        r.x = (a == 0) ? 0 : 1;
+        r.y = 0;
+        return r;
+    }
+    bool yNegative = false;
+    VeryLongInt::performGcd(a, b, r.gcd, &r.y, &yNegative);
+    //Współczynnik przy a z gcd = x a + y b (dzielenie dokładne)
+    VeryLongInt product = r.y * b;
+    if (yNegative)
+        r.x = (product + r.gcd) / a;
+    else
+    {
+        r.x = (product - r.gcd) / a;
+        r.xNegative = true;
+    }
+    return r;
+}
+
+VeryLongInt modinv(const VeryLongInt& a, const VeryLongInt& modulus)
+{
+    if (a.isNaN || modulus.isNaN || modulus == 0)
+        return NaN();
+    if (modulus == 1)
+        return 0;
+    VeryLongInt reduced = a % modulus;
+    if (reduced == 0)
+        return NaN();
+
+    //1 = s m + u a, więc a^(-1) = u mod m; współczynnik przy m nie jest potrzebny
+    VeryLongInt g, u;
+    bool negative = false;
+    VeryLongInt::performGcd(modulus, reduced, g, &u, &negative);
+    if (g != 1)
+        return NaN();
+    u %= modulus;
+    if (negative && u != 0)
+        return modulus - u;
+    return u;
+}
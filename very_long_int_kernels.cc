@@ -0,0 +1,200 @@
+#include "very_long_int_kernels.h"
+
+namespace vlikernel
+{
+
+//Pętle rozwinięte po 4 cyfry, aby przeniesienie jak najdłużej pozostawało we fladze
+//procesora między kolejnymi instrukcjami adc/sbb
+BaseType addN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n)
+{
+    unsigned char carry = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        rp[i] = addCarry(ap[i], bp[i], carry);
+        rp[i + 1] = addCarry(ap[i + 1], bp[i + 1], carry);
+        rp[i + 2] = addCarry(ap[i + 2], bp[i + 2], carry);
+        rp[i + 3] = addCarry(ap[i + 3], bp[i + 3], carry);
+    }
+    for (; i < n; i++)
+        rp[i] = addCarry(ap[i], bp[i], carry);
+    return carry;
+}
+
+BaseType subN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n)
+{
+    unsigned char borrow = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        rp[i] = subBorrow(ap[i], bp[i], borrow);
+        rp[i + 1] = subBorrow(ap[i + 1], bp[i + 1], borrow);
+        rp[i + 2] = subBorrow(ap[i + 2], bp[i + 2], borrow);
+        rp[i + 3] = subBorrow(ap[i + 3], bp[i + 3], borrow);
+    }
+    for (; i < n; i++)
+        rp[i] = subBorrow(ap[i], bp[i], borrow);
+    return borrow;
+}
+
+BaseType add1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b)
+{
+    std::size_t i = 0;
+    //Przeniesienie zwykle wygasa po pierwszej cyfrze
+    for (; i < n && b != 0; i++)
+    {
+        BaseType r = ap[i] + b;
+        b = (r < b);
+        rp[i] = r;
+    }
+    if (rp != ap)
+        for (; i < n; i++)
+            rp[i] = ap[i];
+    return b;
+}
+
+BaseType sub1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b)
+{
+    std::size_t i = 0;
+    for (; i < n && b != 0; i++)
+    {
+        BaseType a = ap[i];
+        rp[i] = a - b;
+        b = (a < b);
+    }
+    if (rp != ap)
+        for (; i < n; i++)
+            rp[i] = ap[i];
+    return b;
+}
+
+BaseType add(BaseType* rp, const BaseType* ap, std::size_t an, const BaseType* bp, std::size_t bn)
+{
+    BaseType carry = addN(rp, ap, bp, bn);
+    return add1(rp + bn, ap + bn, an - bn, carry);
+}
+
+BaseType sub(BaseType* rp, const BaseType* ap, std::size_t an, const BaseType* bp, std::size_t bn)
+{
+    BaseType borrow = subN(rp, ap, bp, bn);
+    return sub1(rp + bn, ap + bn, an - bn, borrow);
+}
+
+BaseType lshift(BaseType* rp, const BaseType* ap, std::size_t n, unsigned cnt)
+{
+    //Idziemy od najstarszej cyfry, aby można było przesuwać "w górę" w tej samej tablicy
+    BaseType out = ap[n - 1] >> (baseBits - cnt);
+    for (std::size_t i = n - 1; i > 0; i--)
+        rp[i] = (ap[i] << cnt) | (ap[i - 1] >> (baseBits - cnt));
+    rp[0] = ap[0] << cnt;
+    return out;
+}
+
+BaseType rshift(BaseType* rp, const BaseType* ap, std::size_t n, unsigned cnt)
+{
+    BaseType out = ap[0] << (baseBits - cnt);
+    for (std::size_t i = 0; i + 1 < n; i++)
+        rp[i] = (ap[i] >> cnt) | (ap[i + 1] << (baseBits - cnt));
+    rp[n - 1] = ap[n - 1] >> cnt;
+    return out;
+}
+
+void andN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i++)
+        rp[i] = ap[i] & bp[i];
+}
+
+void orN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i++)
+        rp[i] = ap[i] | bp[i];
+}
+
+void xorN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i++)
+        rp[i] = ap[i] ^ bp[i];
+}
+
+unsigned long long popcountN(const BaseType* ap, std::size_t n)
+{
+    //Zliczanie równoległe w obrębie cyfry (SWAR) - bez instrukcji popcnt
+    //(niedostępnej w bazowym x86-64) pętla i tak wektoryzuje się
+    unsigned long long count = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        BaseType x = ap[i];
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        count += (x * 0x0101010101010101ULL) >> 56;
+    }
+    return count;
+}
+
+int compareN(const BaseType* ap, const BaseType* bp, std::size_t n)
+{
+    for (std::size_t i = n; i > 0; i--)
+        if (ap[i - 1] != bp[i - 1])
+            return ap[i - 1] < bp[i - 1] ? -1 : 1;
+    return 0;
+}
+
+BaseType mul1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b)
+{
+    BaseType carry = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        DoubleBaseType t = static_cast<DoubleBaseType> (ap[i]) * b + carry;
+        rp[i] = static_cast<BaseType> (t);
+        carry = static_cast<BaseType> (t >> baseBits);
+    }
+    return carry;
+}
+
+BaseType addMul1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b)
+{
+    BaseType carry = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        //a * b + r + carry <= (2^64 - 1)^2 + 2 * (2^64 - 1) = 2^128 - 1, zatem nie ma przepełnienia
+        DoubleBaseType t = static_cast<DoubleBaseType> (ap[i]) * b + rp[i] + carry;
+        rp[i] = static_cast<BaseType> (t);
+        carry = static_cast<BaseType> (t >> baseBits);
+    }
+    return carry;
+}
+
+BaseType subMul1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b)
+{
+    BaseType borrow = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        DoubleBaseType t = static_cast<DoubleBaseType> (ap[i]) * b + borrow;
+        BaseType low = static_cast<BaseType> (t);
+        BaseType r = rp[i];
+        rp[i] = r - low;
+        borrow = static_cast<BaseType> (t >> baseBits) + (r < low);
+    }
+    return borrow;
+}
+
+void divExact3(BaseType* rp, const BaseType* ap, std::size_t n)
+{
+    //Dzielenie dokładne przez mnożenie przez odwrotność 3 modulo 2^64
+    //(3 * 0xAAAAAAAAAAAAAAAB = 1 mod 2^64), bez kosztownego dzielenia 128/64
+    const BaseType inverse = 0xAAAAAAAAAAAAAAABULL;
+    BaseType borrow = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        BaseType a = ap[i];
+        BaseType x = a - borrow;
+        borrow = (a < borrow);
+        BaseType q = x * inverse;
+        rp[i] = q;
+        borrow += static_cast<BaseType> ((static_cast<DoubleBaseType> (q) * 3) >> baseBits);
+    }
+}
+
+}
@@ -0,0 +1,229 @@
+#ifndef VERY_LONG_INT_KERNELS_H
+#define VERY_LONG_INT_KERNELS_H
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#include "very_long_int.h"
+
+/**
+ * Wewnętrzne procedury działające bezpośrednio na tablicach cyfr (limbów)
+ * zapisanych od najmniej znaczącej. Nie są częścią publicznego interfejsu -
+ * korzystają z nich implementacje operatorów VeryLongInt.
+ *
+ * Konwencje:
+ *  - rozmiary podawane są w cyfrach BaseType,
+ *  - wynik może pokrywać się z argumentem tylko tam, gdzie zaznaczono,
+ *  - procedury nie alokują pamięci, chyba że zaznaczono inaczej
+ *    (bufory pomocnicze "scratch" dostarcza wywołujący).
+ */
+namespace vlikernel
+{
+
+//Typ o podwójnej szerokości, w którym mieści się iloczyn dwóch cyfr
+typedef unsigned __int128 DoubleBaseType;
+
+const int baseBits = std::numeric_limits<BaseType>::digits;
+
+//Tymczasowy bufor cyfr alokowany z bieżącego zasobu pamięci (limbResource())
+typedef std::pmr::vector<BaseType> ScratchVector;
+
+//Liczba wiodących zer w cyfrze x != 0
+inline unsigned countLeadingZeros(BaseType x)
+{
+    return __builtin_clzll(x);
+}
+
+//Zwraca a + b + carry, w carry (0 lub 1) zapisuje nowe przeniesienie.
+//Na x86-64 kolejne wywołania kompilują się do łańcucha instrukcji adc.
+inline BaseType addCarry(BaseType a, BaseType b, unsigned char& carry)
+{
+#if defined(__x86_64__)
+    unsigned long long r;
+    carry = _addcarry_u64(carry, a, b, &r);
+    return r;
+#else
+    BaseType r;
+    bool c1 = __builtin_add_overflow(a, b, &r);
+    bool c2 = __builtin_add_overflow(r, static_cast<BaseType> (carry), &r);
+    carry = c1 | c2;
+    return r;
+#endif
+}
+
+//Zwraca a - b - borrow, w borrow (0 lub 1) zapisuje nową pożyczkę (łańcuch sbb na x86-64)
+inline BaseType subBorrow(BaseType a, BaseType b, unsigned char& borrow)
+{
+#if defined(__x86_64__)
+    unsigned long long r;
+    borrow = _subborrow_u64(borrow, a, b, &r);
+    return r;
+#else
+    BaseType r;
+    bool c1 = __builtin_sub_overflow(a, b, &r);
+    bool c2 = __builtin_sub_overflow(r, static_cast<BaseType> (borrow), &r);
+    borrow = c1 | c2;
+    return r;
+#endif
+}
+
+//rp[0..n) = ap[0..n) + bp[0..n), zwraca przeniesienie; rp może być równe ap lub bp
+BaseType addN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n);
+//rp[0..n) = ap[0..n) - bp[0..n), zwraca pożyczkę; rp może być równe ap lub bp
+BaseType subN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n);
+//rp[0..an) = ap[0..an) + bp[0..bn), an >= bn, zwraca przeniesienie; rp może być równe ap
+BaseType add(BaseType* rp, const BaseType* ap, std::size_t an, const BaseType* bp, std::size_t bn);
+//rp[0..an) = ap[0..an) - bp[0..bn), an >= bn, zwraca pożyczkę; rp może być równe ap
+BaseType sub(BaseType* rp, const BaseType* ap, std::size_t an, const BaseType* bp, std::size_t bn);
+//rp[0..n) = ap[0..n) + b, zwraca przeniesienie; rp może być równe ap
+BaseType add1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b);
+//rp[0..n) = ap[0..n) - b, zwraca pożyczkę; rp może być równe ap
+BaseType sub1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b);
+
+//rp[0..n) = ap[0..n) << cnt, 0 < cnt < baseBits, zwraca wysunięte bity;
+//rp może być równe ap lub leżeć wyżej w tej samej tablicy
+BaseType lshift(BaseType* rp, const BaseType* ap, std::size_t n, unsigned cnt);
+//rp[0..n) = ap[0..n) >> cnt, 0 < cnt < baseBits, zwraca wysunięte bity (na najstarszych pozycjach);
+//rp może być równe ap lub leżeć niżej w tej samej tablicy
+BaseType rshift(BaseType* rp, const BaseType* ap, std::size_t n, unsigned cnt);
+
+//rp[0..n) = ap[0..n) & bp[0..n) (odpowiednio |, ^) - cyfra po cyfrze, bez zależności
+//między kolejnymi cyframi, więc pętle są wektoryzowane; rp może być równe ap lub bp
+void andN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n);
+void orN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n);
+void xorN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n);
+//Liczba bitów równych 1 w ap[0..n)
+unsigned long long popcountN(const BaseType* ap, std::size_t n);
+
+//Porównuje ap[0..n) z bp[0..n), zwraca -1, 0 lub 1
+int compareN(const BaseType* ap, const BaseType* bp, std::size_t n);
+
+//rp[0..n) = ap[0..n) * b, zwraca cyfrę przeniesienia; rp może być równe ap
+BaseType mul1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b);
+//rp[0..n) += ap[0..n) * b, zwraca cyfrę przeniesienia
+BaseType addMul1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b);
+//rp[0..n) -= ap[0..n) * b, zwraca cyfrę pożyczki
+BaseType subMul1(BaseType* rp, const BaseType* ap, std::size_t n, BaseType b);
+
+//rp[0..n) = ap[0..n) / 3 przy założeniu, że dzielenie jest dokładne; rp może być równe ap
+void divExact3(BaseType* rp, const BaseType* ap, std::size_t n);
+
+//Mnożenie szkolne: rp[0..an + bn) = ap[0..an) * bp[0..bn), an, bn >= 1
+void mulBasecase(BaseType* rp, const BaseType* ap, std::size_t an,
+                 const BaseType* bp, std::size_t bn);
+//Kwadrat metodą szkolną: rp[0..2n) = ap[0..n)^2, n >= 1; około dwa razy mniej mnożeń cyfr
+void sqrBasecase(BaseType* rp, const BaseType* ap, std::size_t n);
+
+//Odwrotność znormalizowanej cyfry d (najstarszy bit ustawiony): floor((B^2 - 1) / d) - B
+BaseType reciprocal2by1(BaseType d);
+//Odwrotność znormalizowanej pary cyfr (d1, d0): floor((B^3 - 1) / (d1 B + d0)) - B
+BaseType reciprocal3by2(BaseType d1, BaseType d0);
+
+//qp[0..n) = ap[0..n) / d, zwraca resztę; qp może być równe ap lub nullptr (tylko reszta)
+BaseType divRem1(BaseType* qp, const BaseType* ap, std::size_t n, BaseType d);
+//Jak divRem1, ale dla dzielnika przesuniętego o shift bitów do postaci znormalizowanej
+//(d = dzielnik << shift) i v = reciprocal2by1(d) wyznaczonych wcześniej
+BaseType divRem1Preinv(BaseType* qp, const BaseType* ap, std::size_t n,
+                       BaseType d, unsigned shift, BaseType v);
+
+//Dzielenie pisemne (algorytm D Knutha): qp[0..an - dn + 1) = ap / dp, rp[0..dn) = ap % dp,
+//an >= dn >= 2, dp[dn - 1] != 0. qp lub rp mogą być nullptr. Alokuje bufor roboczy.
+void divRem(BaseType* qp, BaseType* rp, const BaseType* ap, std::size_t an,
+            const BaseType* dp, std::size_t dn);
+//Jak divRem, ale dla dzielnika znormalizowanego wcześniej: vp = dzielnik << shift,
+//v = reciprocal3by2(vp[dn - 1], vp[dn - 2])
+void divRemNormalized(BaseType* qp, BaseType* rp, const BaseType* ap, std::size_t an,
+                      const BaseType* vp, std::size_t dn, unsigned shift, BaseType v);
+
+//Mnożenie przez transformatę teorioliczbową: rp[0..an + bn) = ap[0..an) * bp[0..bn).
+//rp nie może pokrywać się z ap ani bp. Korzysta z buforów roboczych bieżącego wątku.
+void nttMul(BaseType* rp, const BaseType* ap, std::size_t an,
+            const BaseType* bp, std::size_t bn);
+//Zwalnia bufory robocze nttMul bieżącego wątku
+void releaseNttScratch();
+
+//10^(19 * 2^k) - tablica potęg wspólna dla wszystkich wątków, liczona przy pierwszym użyciu
+const std::vector<BaseType>& decimalPower(std::size_t k);
+//Górne ograniczenie liczby cyfr dziesiętnych ap[0..n)
+std::size_t decimalDigitsUpperBound(const BaseType* ap, std::size_t n);
+//Zapisuje ap[0..n) dziesiętnie (bez wiodących zer) do out, który musi mieć miejsce
+//na decimalDigitsUpperBound(ap, n) znaków. Zwraca liczbę zapisanych cyfr.
+std::size_t toDecimal(char* out, const BaseType* ap, std::size_t n);
+//Liczba cyfr BaseType wystarczająca dla fromDecimal z napisu o długości len
+std::size_t decimalLimbsUpperBound(std::size_t len);
+//Wczytuje len cyfr dziesiętnych do rp (miejsce na decimalLimbsUpperBound(len) cyfr),
+//sprawdzając przy tym poprawność znaków. Zwraca liczbę cyfr wyniku bez wiodących zer
+//(co najmniej 1) albo 0, jeśli napis jest pusty lub zawiera znak inny niż cyfra.
+std::size_t fromDecimal(BaseType* rp, const char* str, std::size_t len);
+
+//Wartość cyfry c w systemach o podstawie do 36 (litery dowolnej wielkości) albo -1
+int digitValue(char c);
+//Długość najdłuższego przedrostka str[0..len) złożonego z cyfr systemu o podstawie base (do 36)
+std::size_t digitSpan(const char* str, std::size_t len, unsigned base);
+//Liczba cyfr ap[0..n) (bez wiodących zer, co najmniej 1) w systemie o podstawie 2^bits, 1 <= bits <= 5
+std::size_t radixDigits(const BaseType* ap, std::size_t n, unsigned bits);
+//Zapisuje ap[0..n) w systemie o podstawie 2^bits (cyfry 0-9, a-v lub A-V) do out,
+//który ma miejsce na radixDigits(ap, n, bits) znaków. Zwraca liczbę zapisanych cyfr.
+std::size_t toRadix(char* out, const BaseType* ap, std::size_t n, unsigned bits, bool uppercase);
+//Liczba cyfr BaseType wystarczająca dla fromRadix z napisu o długości len
+std::size_t radixLimbsUpperBound(std::size_t len, unsigned bits);
+//Wczytuje len cyfr w systemie o podstawie 2^bits do rp (miejsce na radixLimbsUpperBound(len, bits)
+//cyfr). Zwraca liczbę cyfr wyniku jak fromDecimal (0 dla pustego napisu lub niepoprawnego znaku).
+std::size_t fromRadix(BaseType* rp, const char* str, std::size_t len, unsigned bits);
+
+//Odwrotność nieparzystej cyfry m modulo B
+BaseType inverseLimb(BaseType m);
+//-m^(-1) mod B dla nieparzystej cyfry m (stała redukcji Montgomery'ego)
+BaseType montgomeryInverse(BaseType m);
+//Redukcja Montgomery'ego: rp[0..n) = tp[0..2n) * B^(-n) mod mp[0..n) dla tp < m * B^n,
+//m nieparzyste, inverse = montgomeryInverse(mp[0]). Niszczy tp; rp może być równe tp + n.
+void montgomeryReduce(BaseType* rp, BaseType* tp, const BaseType* mp, std::size_t n,
+                      BaseType inverse);
+//rp[0..n) = xp[0..n)^ep[0..en) mod mp[0..n) dla nieparzystego m, xp < m, ep[en - 1] != 0;
+//r2p[0..n) = B^2n mod m. Alokuje pamięć roboczą jednorazowo, przed pętlą potęgowania.
+void powmodOdd(BaseType* rp, const BaseType* xp, const BaseType* ep, std::size_t en,
+               const BaseType* mp, const BaseType* r2p, std::size_t n, BaseType inverse);
+//rp[0..n) = xp[0..n)^ep[0..en) mod 2^bits, n = ceil(bits / baseBits), ep[en - 1] != 0
+void powmodPowerOfTwo(BaseType* rp, const BaseType* xp, const BaseType* ep, std::size_t en,
+                      std::size_t bits);
+
+//Liczba wątków dostępnych dla obliczeń (threadLimit())
+std::size_t parallelism();
+//Wykonuje tasks[0..count) na wątkach puli i czeka na zakończenie wszystkich;
+//tasks[0] wykonuje wątek wywołujący. Przy jednym wątku wykonuje je kolejno.
+//Wyjątek zgłoszony przez zadanie przekazywany jest wywołującemu.
+void parallelInvoke(const std::function<void()>* tasks, std::size_t count);
+//Dzieli [0, n) na przedziały (co najmniej grain elementów, o ile n na to pozwala)
+//i wywołuje dla nich body(begin, end) na wątkach puli
+void parallelFor(std::size_t n, std::size_t grain,
+                 const std::function<void(std::size_t, std::size_t)>& body);
+
+//Rozmiar bufora pomocniczego dla mulN
+std::size_t mulNScratchSize(std::size_t n);
+//rp[0..2n) = ap[0..n) * bp[0..n) z wyborem algorytmu na podstawie thresholds().
+//rp nie może pokrywać się z ap ani bp. Nie alokuje pamięci - scratch musi mieć
+//mulNScratchSize(n) cyfr (mnożenie transformatą korzysta z buforów bieżącego wątku,
+//a podproblemy liczone równolegle na innych wątkach - z własnych buforów).
+//Dla ap == bp liczony jest kwadrat (sqrN).
+void mulN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n, BaseType* scratch);
+//rp[0..2n) = ap[0..n)^2, wymagania jak dla mulN
+void sqrN(BaseType* rp, const BaseType* ap, std::size_t n, BaseType* scratch);
+
+//rp[0..an + bn) = ap[0..an) * bp[0..bn), an, bn >= 1. Wybiera algorytm
+//na podstawie rozmiarów argumentów i progów z thresholds().
+//rp nie może pokrywać się z ap ani bp. Alokuje bufor pomocniczy.
+//Dla ap == bp i an == bn liczony jest kwadrat (sqr).
+void mul(BaseType* rp, const BaseType* ap, std::size_t an,
+         const BaseType* bp, std::size_t bn);
+//rp[0..2n) = ap[0..n)^2 z wyborem algorytmu na podstawie thresholds().
+//rp nie może pokrywać się z ap. Alokuje bufor pomocniczy.
+void sqr(BaseType* rp, const BaseType* ap, std::size_t n);
+
+}
+
+#endif
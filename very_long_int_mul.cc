@@ -0,0 +1,502 @@
+#include <algorithm>
+#include <assert.h>
+#include <functional>
+#include <vector>
+#include "very_long_int_kernels.h"
+
+namespace vlikernel
+{
+
+void mulBasecase(BaseType* rp, const BaseType* ap, std::size_t an,
+                 const BaseType* bp, std::size_t bn)
+{
+    for (std::size_t i = 0; i < an + bn; i++)
+        rp[i] = 0;
+    for (std::size_t j = 0; j < bn; j++)
+    {
+        //Zera w mnożniku (np. po przesunięciach) nie wymagają przejścia po wierszu
+        if (bp[j] == 0)
+            continue;
+        rp[j + an] = addMul1(rp + j, ap, an, bp[j]);
+    }
+}
+
+//Kwadrat liczy każdy iloczyn a_i a_j (i < j) raz: suma iloczynów mieszanych jest
+//podwajana przesunięciem, a na koniec dodawane są kwadraty cyfr a_i^2 (pozycje 2i, 2i + 1)
+void sqrBasecase(BaseType* rp, const BaseType* ap, std::size_t n)
+{
+    for (std::size_t i = 0; i < 2 * n; i++)
+        rp[i] = 0;
+    for (std::size_t i = 0; i + 1 < n; i++)
+    {
+        if (ap[i] == 0)
+            continue;
+        rp[i + n] = addMul1(rp + 2 * i + 1, ap + i + 1, n - i - 1, ap[i]);
+    }
+    lshift(rp, rp, 2 * n, 1);
+    unsigned char carry = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        DoubleBaseType square = static_cast<DoubleBaseType> (ap[i]) * ap[i];
+        rp[2 * i] = addCarry(rp[2 * i], static_cast<BaseType> (square), carry);
+        rp[2 * i + 1] = addCarry(rp[2 * i + 1], static_cast<BaseType> (square >> baseBits), carry);
+    }
+}
+
+namespace
+{
+
+//Dodaje sp[0..sn) do rp[0..rn). Jeśli sn > rn, nadmiarowe cyfry sp muszą być zerami
+//(wynik mieści się w rp, co wynika z postaci mnożonych liczb)
+void addInto(BaseType* rp, std::size_t rn, const BaseType* sp, std::size_t sn)
+{
+    while (sn > rn)
+    {
+        assert(sp[sn - 1] == 0);
+        sn--;
+    }
+    BaseType carry = add(rp, rp, rn, sp, sn);
+    assert(carry == 0);
+    (void) carry;
+}
+
+//dp[0..k) = |xp[0..k) - yp[0..h)|, k >= h, zwraca true, jeśli różnica jest ujemna
+bool absDiff(BaseType* dp, const BaseType* xp, std::size_t k, const BaseType* yp, std::size_t h)
+{
+    if (sub(dp, xp, k, yp, h) == 0)
+        return false;
+    //Wynik "zawinął się" modulo B^k - negujemy go w kodzie uzupełnień do dwóch
+    for (std::size_t i = 0; i < k; i++)
+        dp[i] = ~dp[i];
+    add1(dp, dp, k, 1);
+    return true;
+}
+
+}
+
+//Poziom rekurencji o rozmiarze m zużywa co najwyżej 5m + 24 cyfr, a rozmiar
+//podproblemu nie przekracza (m + 1) / 2, więc suma po wszystkich poziomach
+//jest mniejsza niż 10n + 2048.
+std::size_t mulNScratchSize(std::size_t n)
+{
+    return 10 * n + 2048;
+}
+
+namespace
+{
+
+//Iloczyn rp[0..2n) = ap[0..n) * bp[0..n) - jeden z niezależnych podproblemów
+struct Product
+{
+    BaseType* rp;
+    const BaseType* ap;
+    const BaseType* bp;
+    std::size_t n;
+};
+
+//Czy podproblemy rozmiaru n liczyć równolegle
+bool parallel(std::size_t n)
+{
+    return parallelism() > 1 && n >= thresholds().parallelMul;
+}
+
+//Liczy iloczyny products[0..count), które zapisują wyniki do rozłącznych obszarów.
+//Równolegle pierwszy z nich korzysta ze scratch, a pozostałe z własnych buforów.
+void mulProducts(const Product* products, std::size_t count, BaseType* scratch)
+{
+    if (!parallel(products[0].n))
+    {
+        for (std::size_t i = 0; i < count; i++)
+            mulN(products[i].rp, products[i].ap, products[i].bp, products[i].n, scratch);
+        return;
+    }
+    std::vector<std::function<void()>> tasks(count);
+    tasks[0] = [&] { mulN(products[0].rp, products[0].ap, products[0].bp, products[0].n, scratch); };
+    for (std::size_t i = 1; i < count; i++)
+    {
+        const Product& p = products[i];
+        tasks[i] = [&p] {
+            ScratchVector own(mulNScratchSize(p.n), limbResource());
+            mulN(p.rp, p.ap, p.bp, p.n, own.data());
+        };
+    }
+    parallelInvoke(tasks.data(), count);
+}
+
+//Karatsuba w wersji "odejmującej": a = a1 B^k + a0, b = b1 B^k + b0,
+//ab = z2 B^2k + (z0 + z2 - (a0 - a1)(b0 - b1)) B^k + z0,
+//dzięki czemu wszystkie czynniki mają k cyfr (bez przeniesień z sumowania połówek)
+void karatsuba(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n, BaseType* scratch)
+{
+    const std::size_t k = (n + 1) / 2;
+    const std::size_t h = n - k;
+    BaseType* da = scratch;
+    BaseType* db = da + k;
+    BaseType* t = db + k;
+    BaseType* u = t + 2 * k;
+    BaseType* next = u + 2 * k + 1;
+
+    bool negative = absDiff(da, ap, k, ap + k, h) != absDiff(db, bp, k, bp + k, h);
+
+    const Product products[] = {
+        {rp, ap, bp, k},                  //z0
+        {rp + 2 * k, ap + k, bp + k, h},  //z2
+        {t, da, db, k}                    //|a0 - a1| * |b0 - b1|
+    };
+    mulProducts(products, 3, next);
+
+    u[2 * k] = add(u, rp, 2 * k, rp + 2 * k, 2 * h);
+    if (negative)
+        u[2 * k] += addN(u, u, t, 2 * k);
+    else
+        u[2 * k] -= subN(u, u, t, 2 * k);
+
+    addInto(rp + k, 2 * n - k, u, 2 * k + 1);
+}
+
+//Karatsuba dla kwadratu: a^2 = z2 B^2k + (z0 + z2 - (a0 - a1)^2) B^k + z0,
+//środkowy składnik jest zawsze nieujemny
+void karatsubaSqr(BaseType* rp, const BaseType* ap, std::size_t n, BaseType* scratch)
+{
+    const std::size_t k = (n + 1) / 2;
+    const std::size_t h = n - k;
+    BaseType* da = scratch;
+    BaseType* t = da + k;
+    BaseType* u = t + 2 * k;
+    BaseType* next = u + 2 * k + 1;
+
+    absDiff(da, ap, k, ap + k, h);
+
+    //mulN liczy kwadrat dla identycznych argumentów
+    const Product products[] = {
+        {rp, ap, ap, k},                  //z0
+        {rp + 2 * k, ap + k, ap + k, h},  //z2
+        {t, da, da, k}                    //(a0 - a1)^2
+    };
+    mulProducts(products, 3, next);
+
+    u[2 * k] = add(u, rp, 2 * k, rp + 2 * k, 2 * h);
+    u[2 * k] -= subN(u, u, t, 2 * k);
+
+    addInto(rp + k, 2 * n - k, u, 2 * k + 1);
+}
+
+//Wartości a0 + a1 + a2, |a0 - a1 + a2| i a0 + 2 a1 + 4 a2 dla a = a2 B^2k + a1 B^k + a0,
+//każda zapisana na k + 1 cyfrach. Zwraca true, jeśli a0 - a1 + a2 < 0.
+bool toom3Evaluate(const BaseType* ap, std::size_t n, std::size_t k,
+                   BaseType* p1, BaseType* pm1, BaseType* p2)
+{
+    const std::size_t h = n - 2 * k;
+    const BaseType* a0 = ap;
+    const BaseType* a1 = ap + k;
+    const BaseType* a2 = ap + 2 * k;
+
+    //a0 + a2
+    pm1[k] = add(pm1, a0, k, a2, h);
+    //a0 + a1 + a2
+    p1[k] = pm1[k] + addN(p1, pm1, a1, k);
+
+    bool negative = false;
+    if (pm1[k] == 0 && compareN(pm1, a1, k) < 0)
+    {
+        subN(pm1, a1, pm1, k);
+        negative = true;
+    }
+    else
+        pm1[k] -= subN(pm1, pm1, a1, k);
+
+    //Schemat Hornera: (2 a2 + a1) * 2 + a0
+    std::copy(a2, a2 + h, p2);
+    std::fill(p2 + h, p2 + k + 1, 0);
+    lshift(p2, p2, k + 1, 1);
+    add(p2, p2, k + 1, a1, k);
+    lshift(p2, p2, k + 1, 1);
+    add(p2, p2, k + 1, a0, k);
+    return negative;
+}
+
+//Odtwarza współczynniki c0..c4 iloczynu wielomianów z wartości w punktach
+//0 (c0 w rp), nieskończoność (c4 w rp + 4k), 1 (w1), -1 (wm1) i 2 (w2), każda z nich
+//na l = 2k + 2 cyfrach; negativeM1 - znak r(-1). Interpolacja wykonywana jest
+//wyłącznie na liczbach nieujemnych (współczynniki iloczynu są nieujemne).
+void toom3Interpolate(BaseType* rp, std::size_t n, std::size_t k, BaseType* w1, BaseType* wm1,
+                      BaseType* w2, BaseType* x, bool negativeM1)
+{
+    const std::size_t h = n - 2 * k;
+    const std::size_t l = 2 * k + 2;
+    const BaseType* c0 = rp;
+    const BaseType* c4 = rp + 4 * k;
+
+    //x = r(1) + r(-1), wm1 = r(1) - r(-1)
+    if (negativeM1)
+    {
+        subN(x, w1, wm1, l);
+        addN(wm1, w1, wm1, l);
+    }
+    else
+    {
+        addN(x, w1, wm1, l);
+        subN(wm1, w1, wm1, l);
+    }
+    //x = (r(1) + r(-1)) / 2 - c0 - c4 = c2
+    rshift(x, x, l, 1);
+    sub(x, x, l, c0, 2 * k);
+    sub(x, x, l, c4, 2 * h);
+    //wm1 = (r(1) - r(-1)) / 2 = c1 + c3
+    rshift(wm1, wm1, l, 1);
+    //w2 = (r(2) - c0 - 4 c2 - 16 c4) / 2 = c1 + 4 c3
+    sub(w2, w2, l, c0, 2 * k);
+    lshift(w1, x, l, 2);
+    subN(w2, w2, w1, l);
+    std::copy(c4, c4 + 2 * h, w1);
+    std::fill(w1 + 2 * h, w1 + l, 0);
+    lshift(w1, w1, l, 4);
+    subN(w2, w2, w1, l);
+    rshift(w2, w2, l, 1);
+    //w2 = c3, wm1 = c1
+    subN(w2, w2, wm1, l);
+    divExact3(w2, w2, l);
+    subN(wm1, wm1, w2, l);
+
+    std::fill(rp + 2 * k, rp + 4 * k, 0);
+    addInto(rp + k, 2 * n - k, wm1, l);
+    addInto(rp + 2 * k, 2 * n - 2 * k, x, l);
+    addInto(rp + 3 * k, 2 * n - 3 * k, w2, l);
+}
+
+//Toom-Cook 3 z punktami 0, 1, -1, 2, nieskończoność
+void toom3(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n, BaseType* scratch)
+{
+    const std::size_t k = (n + 2) / 3;
+    const std::size_t h = n - 2 * k;
+    const std::size_t l = 2 * k + 2;
+
+    BaseType* pa1 = scratch;
+    BaseType* pam1 = pa1 + (k + 1);
+    BaseType* pa2 = pam1 + (k + 1);
+    BaseType* pb1 = pa2 + (k + 1);
+    BaseType* pbm1 = pb1 + (k + 1);
+    BaseType* pb2 = pbm1 + (k + 1);
+    BaseType* w1 = pb2 + (k + 1);
+    BaseType* wm1 = w1 + l;
+    BaseType* w2 = wm1 + l;
+    BaseType* x = w2 + l;
+    BaseType* next = x + l;
+
+    bool negativeM1 = toom3Evaluate(ap, n, k, pa1, pam1, pa2)
+                      != toom3Evaluate(bp, n, k, pb1, pbm1, pb2);
+
+    const Product products[] = {
+        {rp, ap, bp, k},                          //c0 = r(0)
+        {rp + 4 * k, ap + 2 * k, bp + 2 * k, h},  //c4 = r(nieskończoność)
+        {w1, pa1, pb1, k + 1},
+        {wm1, pam1, pbm1, k + 1},
+        {w2, pa2, pb2, k + 1}
+    };
+    mulProducts(products, 5, next);
+
+    toom3Interpolate(rp, n, k, w1, wm1, w2, x, negativeM1);
+}
+
+//Toom-Cook 3 dla kwadratu: jedno wartościowanie i pięć kwadratów (r(-1) >= 0)
+void toom3Sqr(BaseType* rp, const BaseType* ap, std::size_t n, BaseType* scratch)
+{
+    const std::size_t k = (n + 2) / 3;
+    const std::size_t h = n - 2 * k;
+    const std::size_t l = 2 * k + 2;
+
+    BaseType* pa1 = scratch;
+    BaseType* pam1 = pa1 + (k + 1);
+    BaseType* pa2 = pam1 + (k + 1);
+    BaseType* w1 = pa2 + (k + 1);
+    BaseType* wm1 = w1 + l;
+    BaseType* w2 = wm1 + l;
+    BaseType* x = w2 + l;
+    BaseType* next = x + l;
+
+    toom3Evaluate(ap, n, k, pa1, pam1, pa2);
+
+    const Product products[] = {
+        {rp, ap, ap, k},
+        {rp + 4 * k, ap + 2 * k, ap + 2 * k, h},
+        {w1, pa1, pa1, k + 1},
+        {wm1, pam1, pam1, k + 1},
+        {w2, pa2, pa2, k + 1}
+    };
+    mulProducts(products, 5, next);
+
+    toom3Interpolate(rp, n, k, w1, wm1, w2, x, false);
+}
+
+}
+
+void mulN(BaseType* rp, const BaseType* ap, const BaseType* bp, std::size_t n, BaseType* scratch)
+{
+    if (ap == bp)
+    {
+        sqrN(rp, ap, n, scratch);
+        return;
+    }
+    const VeryLongIntThresholds& limits = thresholds();
+    if (n >= limits.nttMul)
+        nttMul(rp, ap, n, bp, n);
+    else if (n >= limits.toom3Mul && n >= 5)
+        toom3(rp, ap, bp, n, scratch);
+    else if (n >= limits.karatsubaMul && n >= 2)
+        karatsuba(rp, ap, bp, n, scratch);
+    else
+        mulBasecase(rp, ap, n, bp, n);
+}
+
+void sqrN(BaseType* rp, const BaseType* ap, std::size_t n, BaseType* scratch)
+{
+    const VeryLongIntThresholds& limits = thresholds();
+    if (n >= limits.nttMul)
+        nttMul(rp, ap, n, ap, n);
+    else if (n >= limits.toom3Sqr && n >= 5)
+        toom3Sqr(rp, ap, n, scratch);
+    else if (n >= limits.karatsubaSqr && n >= 2)
+        karatsubaSqr(rp, ap, n, scratch);
+    else
+        sqrBasecase(rp, ap, n);
+}
+
+namespace
+{
+
+std::size_t mulScratchSize(std::size_t an, std::size_t bn)
+{
+    if (an == bn)
+        return mulNScratchSize(bn);
+    std::size_t rest = an % bn;
+    std::size_t restSize = (rest == 0) ? 0 : mulScratchSize(bn, rest);
+    return 2 * bn + std::max(mulNScratchSize(bn), restSize);
+}
+
+//Mnożenie argumentów o różnych długościach (an >= bn): dłuższy argument dzielony jest
+//na kawałki po bn cyfr, a każdy kawałek mnożony jest przez b algorytmem zrównoważonym.
+//Dzięki temu koszt wynosi (an / bn) * M(bn), a nie an * bn.
+void mulUnbalanced(BaseType* rp, const BaseType* ap, std::size_t an,
+                   const BaseType* bp, std::size_t bn, BaseType* scratch)
+{
+    if (an == bn)
+    {
+        mulN(rp, ap, bp, bn, scratch);
+        return;
+    }
+    BaseType* tmp = scratch;
+    BaseType* next = tmp + 2 * bn;
+
+    mulN(rp, ap, bp, bn, next);
+    for (std::size_t offset = bn; offset < an; offset += bn)
+    {
+        std::size_t len = std::min(bn, an - offset);
+        if (len == bn)
+            mulN(tmp, ap + offset, bp, bn, next);
+        else
+            mulUnbalanced(tmp, bp, bn, ap + offset, len, next);
+        //rp[offset..offset + bn) jest już zapisane przez poprzedni kawałek,
+        //rp[offset + bn..offset + bn + len) jeszcze nie
+        BaseType carry = addN(rp + offset, rp + offset, tmp, bn);
+        std::copy(tmp + bn, tmp + bn + len, rp + offset + bn);
+        carry = add1(rp + offset + bn, rp + offset + bn, len, carry);
+        assert(carry == 0);
+    }
+}
+
+//Jak mulUnbalanced, ale iloczyny kawałków liczone są równolegle (do osobnych obszarów
+//bufora, po 2 bn cyfr na kawałek) i dopiero potem sumowane w kolejności kawałków
+void mulUnbalancedParallel(BaseType* rp, const BaseType* ap, std::size_t an,
+                           const BaseType* bp, std::size_t bn)
+{
+    const std::size_t chunks = (an + bn - 1) / bn;
+    const std::size_t rest = an % bn;
+    const std::size_t scratchSize = std::max(mulNScratchSize(bn), rest == 0 ? 0 : mulScratchSize(bn, rest));
+    ScratchVector products(2 * bn * chunks, limbResource());
+    BaseType* pp = products.data();
+
+    //Kawałki grupowane są tak, by zadanie obejmowało co najmniej parallelMul^2 mnożeń cyfr
+    const std::size_t limit = thresholds().parallelMul;
+    const std::size_t grain = std::max<std::size_t>(limit * limit / (bn * bn), 1);
+    parallelFor(chunks, grain, [&](std::size_t begin, std::size_t end) {
+        ScratchVector scratch(scratchSize, limbResource());
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const std::size_t offset = i * bn;
+            const std::size_t len = std::min(bn, an - offset);
+            if (len == bn)
+                mulN(pp + 2 * bn * i, ap + offset, bp, bn, scratch.data());
+            else
+                mulUnbalanced(pp + 2 * bn * i, bp, bn, ap + offset, len, scratch.data());
+        }
+    });
+
+    std::copy(pp, pp + 2 * bn, rp);
+    for (std::size_t i = 1; i < chunks; i++)
+    {
+        const std::size_t offset = i * bn;
+        const std::size_t len = std::min(bn, an - offset);
+        const BaseType* tmp = pp + 2 * bn * i;
+        BaseType carry = addN(rp + offset, rp + offset, tmp, bn);
+        std::copy(tmp + bn, tmp + bn + len, rp + offset + bn);
+        carry = add1(rp + offset + bn, rp + offset + bn, len, carry);
+        assert(carry == 0);
+    }
+}
+
+}
+
+void mul(BaseType* rp, const BaseType* ap, std::size_t an,
+         const BaseType* bp, std::size_t bn)
+{
+    if (ap == bp && an == bn)
+    {
+        sqr(rp, ap, an);
+        return;
+    }
+    if (an < bn)
+    {
+        std::swap(ap, bp);
+        std::swap(an, bn);
+    }
+    const VeryLongIntThresholds& limits = thresholds();
+    if (bn < limits.karatsubaMul && bn < limits.toom3Mul)
+    {
+        mulBasecase(rp, ap, an, bp, bn);
+        return;
+    }
+    //Transformata obsługuje argumenty różnej długości bez dzielenia na kawałki
+    if (bn >= limits.nttMul)
+    {
+        nttMul(rp, ap, an, bp, bn);
+        return;
+    }
+    //Kawałki dłuższego argumentu są niezależne - równolegle opłaca się je liczyć
+    //nawet wtedy, gdy pojedynczy kawałek jest za mały na podział
+    if (an > bn && parallelism() > 1 && an >= limits.parallelMul)
+    {
+        mulUnbalancedParallel(rp, ap, an, bp, bn);
+        return;
+    }
+    ScratchVector scratch(mulScratchSize(an, bn), limbResource());
+    mulUnbalanced(rp, ap, an, bp, bn, scratch.data());
+}
+
+void sqr(BaseType* rp, const BaseType* ap, std::size_t n)
+{
+    const VeryLongIntThresholds& limits = thresholds();
+    if (n < limits.karatsubaSqr && n < limits.toom3Sqr)
+    {
+        sqrBasecase(rp, ap, n);
+        return;
+    }
+    if (n >= limits.nttMul)
+    {
+        nttMul(rp, ap, n, ap, n);
+        return;
+    }
+    ScratchVector scratch(mulNScratchSize(n), limbResource());
+    sqrN(rp, ap, n, scratch.data());
+}
+
+}
@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <assert.h>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "very_long_int_kernels.h"
+
+/**
+ * Mnożenie przez szybką transformatę teorioliczbową (NTT).
+ *
+ * Cyfry argumentów traktowane są jako współczynniki wielomianów, a ich splot
+ * liczony jest modulo trzy liczby pierwsze postaci c * 2^51 + 1 (nieco poniżej 2^63).
+ * Każdy współczynnik splotu jest mniejszy niż 2^128 * N < p0 * p1 * p2,
+ * więc odtwarza się go jednoznacznie z chińskiego twierdzenia o resztach
+ * (algorytm Garnera), a przeniesienia rozprowadzane są w trakcie składania wyniku.
+ *
+ * Arytmetyka modularna korzysta z redukcji Montgomery'ego (R = 2^64).
+ * Transformata jest wykonywana w miejscu (DIF w przód, DIT wstecz, bez permutacji
+ * odwracającej bity), a bufory robocze trzymane są per wątek i używane ponownie.
+ * Przy threadLimit() > 1 sploty modulo trzy liczby pierwsze liczone są równolegle
+ * (na buforach przydzielanych na czas wywołania), a poziomy motylków dużych
+ * transformat dzielone są między wątki.
+ */
+namespace vlikernel
+{
+
+namespace
+{
+
+struct NttPrime
+{
+    BaseType p;
+    BaseType negInverse; //-p^(-1) mod 2^64
+    BaseType r2;         //R^2 mod p
+    BaseType one;        //R mod p, czyli 1 w postaci Montgomery'ego
+    BaseType generator;  //generator grupy multiplikatywnej (w postaci Montgomery'ego)
+
+    NttPrime(BaseType prime, BaseType g) : p(prime)
+    {
+        //Odwrotność modulo 2^64 metodą Newtona - każdy krok podwaja liczbę poprawnych bitów
+        BaseType inverse = p;
+        for (int i = 0; i < 6; i++)
+            inverse *= 2 - p * inverse;
+        negInverse = -inverse;
+        one = static_cast<BaseType> ((static_cast<DoubleBaseType> (1) << baseBits) % p);
+        r2 = static_cast<BaseType> ((static_cast<DoubleBaseType> (one) * one) % p);
+        generator = toMont(g);
+    }
+
+    //a * b * R^(-1) mod p, dla a, b < p
+    BaseType mul(BaseType a, BaseType b) const
+    {
+        DoubleBaseType t = static_cast<DoubleBaseType> (a) * b;
+        BaseType m = static_cast<BaseType> (t) * negInverse;
+        BaseType u = static_cast<BaseType> ((t + static_cast<DoubleBaseType> (m) * p) >> baseBits);
+        return u >= p ? u - p : u;
+    }
+
+    BaseType add(BaseType a, BaseType b) const
+    {
+        BaseType s = a + b;
+        return s >= p ? s - p : s;
+    }
+
+    BaseType sub(BaseType a, BaseType b) const
+    {
+        return a >= b ? a - b : a + (p - b);
+    }
+
+    BaseType toMont(BaseType a) const
+    {
+        return mul(a, r2);
+    }
+
+    BaseType pow(BaseType base, BaseType exp) const
+    {
+        BaseType result = one;
+        while (exp != 0)
+        {
+            if (exp & 1)
+                result = mul(result, base);
+            base = mul(base, base);
+            exp >>= 1;
+        }
+        return result;
+    }
+
+    //Pierwiastek pierwotny z jedności stopnia order (w postaci Montgomery'ego)
+    BaseType root(std::size_t order, bool inverse) const
+    {
+        BaseType e = (p - 1) / order;
+        return pow(generator, inverse ? (p - 1) - e : e);
+    }
+};
+
+const NttPrime& prime(int i)
+{
+    static const NttPrime primes[3] = {
+        NttPrime(0x7fa8000000000001ULL, 3),
+        NttPrime(0x7f18000000000001ULL, 3),
+        NttPrime(0x7e78000000000001ULL, 5)
+    };
+    return primes[i];
+}
+
+//Największa długość transformaty - 2^51 dzieli p - 1 dla wszystkich trzech liczb pierwszych
+const std::size_t maxTransformLength = static_cast<std::size_t> (1) << 51;
+
+//Sploty modulo kolejne liczby pierwsze trafiają do results[i]; sekwencyjnie
+//wystarczają operands[0] i twiddles[0], równolegle każdy splot ma własne
+struct NttScratch
+{
+    std::vector<BaseType> results[3], operands[3], twiddles[3];
+};
+
+thread_local NttScratch scratch;
+
+//Bufory tylko rosną - kolejne mnożenia podobnego rozmiaru nie alokują pamięci
+void reserve(std::vector<BaseType>& buffer, std::size_t n)
+{
+    if (buffer.size() < n)
+        buffer.resize(n);
+}
+
+//Potęgi pierwiastka stopnia 2 * len: twiddles[j] = w^j, j < len
+void computeTwiddles(const NttPrime& f, BaseType* twiddles, std::size_t len, bool inverse)
+{
+    BaseType w = f.root(2 * len, inverse);
+    twiddles[0] = f.one;
+    for (std::size_t j = 1; j < len; j++)
+        twiddles[j] = f.mul(twiddles[j - 1], w);
+}
+
+//Poziomy o tylu motylkach dzielone są między wątki, po co najmniej parallelGrain motylków
+const std::size_t parallelButterflies = static_cast<std::size_t> (1) << 15;
+const std::size_t parallelGrain = static_cast<std::size_t> (1) << 13;
+
+//Jeden poziom transformaty: n / 2 motylków łączących a[start + j] z a[start + len + j].
+//Motylki numerowane są kolejno (b = start / 2 + j), a butterfly(x, y, j0, j1) wykonuje
+//te o indeksach j0 <= j < j1 jednego bloku.
+template <typename Butterfly>
+void level(BaseType* a, std::size_t n, std::size_t len, Butterfly butterfly)
+{
+    auto range = [&](std::size_t begin, std::size_t end) {
+        std::size_t j = begin % len;
+        BaseType* x = a + 2 * (begin - j);
+        for (std::size_t b = begin; b < end; x += 2 * len)
+        {
+            const std::size_t stop = std::min(len, j + (end - b));
+            butterfly(x, x + len, j, stop);
+            b += stop - j;
+            j = 0;
+        }
+    };
+    if (n / 2 >= parallelButterflies && parallelism() > 1)
+        parallelFor(n / 2, parallelGrain, range);
+    else
+        range(0, n / 2);
+}
+
+//Transformata w przód (Gentleman-Sande), wynik w kolejności odwróconych bitów
+void forward(const NttPrime& f, BaseType* a, std::size_t n, BaseType* twiddles)
+{
+    for (std::size_t len = n / 2; len >= 1; len /= 2)
+    {
+        computeTwiddles(f, twiddles, len, false);
+        level(a, n, len, [&f, twiddles](BaseType* x, BaseType* y, std::size_t j0, std::size_t j1) {
+            for (std::size_t j = j0; j < j1; j++)
+            {
+                BaseType u = x[j];
+                BaseType v = y[j];
+                x[j] = f.add(u, v);
+                y[j] = f.mul(f.sub(u, v), twiddles[j]);
+            }
+        });
+    }
+}
+
+//Transformata odwrotna (Cooley-Tukey) z wejściem w kolejności odwróconych bitów,
+//bez dzielenia przez n
+void inverse(const NttPrime& f, BaseType* a, std::size_t n, BaseType* twiddles)
+{
+    for (std::size_t len = 1; len < n; len *= 2)
+    {
+        computeTwiddles(f, twiddles, len, true);
+        level(a, n, len, [&f, twiddles](BaseType* x, BaseType* y, std::size_t j0, std::size_t j1) {
+            for (std::size_t j = j0; j < j1; j++)
+            {
+                BaseType u = x[j];
+                BaseType v = f.mul(y[j], twiddles[j]);
+                x[j] = f.add(u, v);
+                y[j] = f.sub(u, v);
+            }
+        });
+    }
+}
+
+//Przepisuje cyfry do bufora transformaty, redukując je modulo p (p > 2^62, więc wystarczą
+//co najwyżej trzy odejmowania) i dopełniając zerami do długości n
+void load(const NttPrime& f, BaseType* dst, const BaseType* src, std::size_t len, std::size_t n)
+{
+    for (std::size_t i = 0; i < len; i++)
+    {
+        BaseType x = src[i];
+        while (x >= f.p)
+            x -= f.p;
+        dst[i] = x;
+    }
+    for (std::size_t i = len; i < n; i++)
+        dst[i] = 0;
+}
+
+//Splot modulo i-ta liczba pierwsza, wynik w fa[0..n); fb[0..n) i twiddles[0..n / 2] - bufory robocze
+void convolution(int i, const BaseType* ap, std::size_t an, const BaseType* bp, std::size_t bn,
+                 std::size_t n, BaseType* fa, BaseType* fb, BaseType* twiddles)
+{
+    const NttPrime& f = prime(i);
+    bool square = (ap == bp && an == bn);
+
+    load(f, fa, ap, an, n);
+    forward(f, fa, n, twiddles);
+    if (square)
+    {
+        for (std::size_t k = 0; k < n; k++)
+            fa[k] = f.mul(fa[k], fa[k]);
+    }
+    else
+    {
+        load(f, fb, bp, bn, n);
+        forward(f, fb, n, twiddles);
+        for (std::size_t k = 0; k < n; k++)
+            fa[k] = f.mul(fa[k], fb[k]);
+    }
+    inverse(f, fa, n, twiddles);
+
+    //Iloczyn Montgomery'ego w punktach wprowadził czynnik R^(-1), a transformata
+    //odwrotna czynnik n - oba znoszą się mnożąc przez n^(-1) * R^2
+    BaseType nInverse = f.p - (f.p - 1) / n;
+    BaseType scale = f.toMont(f.toMont(nInverse));
+    for (std::size_t k = 0; k < n; k++)
+        fa[k] = f.mul(fa[k], scale);
+}
+
+//Stałe do odtwarzania współczynników z reszt (algorytm Garnera)
+struct CrtConstants
+{
+    BaseType inv01;      //p0^(-1) mod p1 (postać Montgomery'ego modulo p1)
+    BaseType p0ModP2;    //p0 mod p2 (postać Montgomery'ego modulo p2)
+    BaseType inv012;     //(p0 * p1)^(-1) mod p2 (postać Montgomery'ego modulo p2)
+    DoubleBaseType p01;  //p0 * p1
+
+    CrtConstants()
+    {
+        const NttPrime& f0 = prime(0);
+        const NttPrime& f1 = prime(1);
+        const NttPrime& f2 = prime(2);
+        //Odwrotność z małego twierdzenia Fermata: x^(p - 2)
+        inv01 = f1.pow(f1.toMont(f0.p % f1.p), f1.p - 2);
+        p0ModP2 = f2.toMont(f0.p % f2.p);
+        BaseType p01ModP2 = f2.mul(p0ModP2, f2.toMont(f1.p % f2.p));
+        inv012 = f2.pow(p01ModP2, f2.p - 2);
+        p01 = static_cast<DoubleBaseType> (f0.p) * f1.p;
+    }
+};
+
+}
+
+void nttMul(BaseType* rp, const BaseType* ap, std::size_t an,
+            const BaseType* bp, std::size_t bn)
+{
+    const std::size_t rn = an + bn;
+    std::size_t n = 1;
+    while (n < rn - 1)
+        n *= 2;
+    assert(n <= maxTransformLength);
+    (void) maxTransformLength;
+
+    //Sploty są niezależne; bufory przekazywane są jawnie, bo zadania wykonywane
+    //na innych wątkach widziałyby własne (puste) bufory thread_local
+    //Wątek czekający na swoje zadania wykonuje w tym czasie inne, w tym być może kolejne
+    //mnożenie transformatą - równolegle bufory są więc lokalne dla wywołania
+    const std::size_t buffers = parallelism() > 1 ? 3 : 1;
+    NttScratch local;
+    NttScratch& work = buffers > 1 ? local : scratch;
+    BaseType* results[3];
+    BaseType* operands[3];
+    BaseType* twiddles[3];
+    for (int i = 0; i < 3; i++)
+    {
+        reserve(work.results[i], n);
+        results[i] = work.results[i].data();
+        if (static_cast<std::size_t> (i) < buffers)
+        {
+            reserve(work.operands[i], n);
+            reserve(work.twiddles[i], n / 2 + 1);
+        }
+        const std::size_t own = static_cast<std::size_t> (i) < buffers ? i : 0;
+        operands[i] = work.operands[own].data();
+        twiddles[i] = work.twiddles[own].data();
+    }
+    std::function<void()> tasks[3];
+    for (int i = 0; i < 3; i++)
+        tasks[i] = [=] { convolution(i, ap, an, bp, bn, n, results[i], operands[i], twiddles[i]); };
+    parallelInvoke(tasks, 3);
+
+    static const CrtConstants crt;
+    const NttPrime& f1 = prime(1);
+    const NttPrime& f2 = prime(2);
+    const BaseType* x0 = results[0];
+    const BaseType* x1 = results[1];
+    const BaseType* x2 = results[2];
+    const BaseType p01Low = static_cast<BaseType> (crt.p01);
+    const BaseType p01High = static_cast<BaseType> (crt.p01 >> baseBits);
+
+    DoubleBaseType carry = 0;
+    for (std::size_t k = 0; k + 1 < rn; k++)
+    {
+        //value = v0 + v1 * p0 + v2 * p0 * p1, gdzie v0 < p0, v1 < p1, v2 < p2
+        BaseType v0 = x0[k];
+        BaseType v0ModP1 = v0 >= f1.p ? v0 - f1.p : v0;
+        BaseType v1 = f1.mul(f1.sub(x1[k], v0ModP1), crt.inv01);
+        BaseType v0ModP2 = v0 >= f2.p ? v0 - f2.p : v0;
+        BaseType v1ModP2 = v1 >= f2.p ? v1 - f2.p : v1;
+        BaseType t = f2.sub(f2.sub(x2[k], v0ModP2), f2.mul(v1ModP2, crt.p0ModP2));
+        BaseType v2 = f2.mul(t, crt.inv012);
+
+        DoubleBaseType low = static_cast<DoubleBaseType> (v1) * prime(0).p + v0;
+        DoubleBaseType x = static_cast<DoubleBaseType> (v2) * p01Low;
+        DoubleBaseType y = static_cast<DoubleBaseType> (v2) * p01High;
+        DoubleBaseType mid = (x >> baseBits) + static_cast<BaseType> (y);
+
+        //Trzy cyfry wartości plus 128-bitowe przeniesienie z poprzedniej pozycji
+        DoubleBaseType s0 = static_cast<DoubleBaseType> (static_cast<BaseType> (x))
+                            + static_cast<BaseType> (low) + static_cast<BaseType> (carry);
+        DoubleBaseType s1 = static_cast<DoubleBaseType> (static_cast<BaseType> (mid))
+                            + static_cast<BaseType> (low >> baseBits)
+                            + static_cast<BaseType> (carry >> baseBits) + (s0 >> baseBits);
+        BaseType s2 = static_cast<BaseType> (y >> baseBits) + static_cast<BaseType> (mid >> baseBits)
+                      + static_cast<BaseType> (s1 >> baseBits);
+        rp[k] = static_cast<BaseType> (s0);
+        carry = (static_cast<DoubleBaseType> (s2) << baseBits) | static_cast<BaseType> (s1);
+    }
+    rp[rn - 1] = static_cast<BaseType> (carry);
+    assert((carry >> baseBits) == 0);
+}
+
+void releaseNttScratch()
+{
+    scratch = NttScratch();
+}
+
+}
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "very_long_int_kernels.h"
+
+/**
+ * Pula wątków dla równoległego mnożenia bardzo dużych liczb.
+ *
+ * Każdy wątek puli ma własną kolejkę zadań: nowe zadania odkłada na jej koniec
+ * i stamtąd je pobiera (najpierw najmniejsze, świeżo podzielone podproblemy),
+ * a gdy jest pusta - podkrada najstarsze zadania z kolejek innych wątków.
+ * Wątek czekający na zakończenie swoich zadań (parallelInvoke) w tym czasie
+ * wykonuje zadania z kolejek, więc zagnieżdżone podziały nie blokują puli.
+ *
+ * Zadania zapisują wyniki do rozłącznych obszarów pamięci, a ich składanie
+ * odbywa się po zakończeniu wszystkich w ustalonej kolejności, dlatego wynik
+ * nie zależy od liczby wątków ani od kolejności wykonania.
+ */
+namespace vlikernel
+{
+
+namespace
+{
+
+struct TaskGroup
+{
+    std::atomic<std::size_t> remaining;
+    std::mutex mutex;
+    std::exception_ptr error;
+};
+
+struct Task
+{
+    const std::function<void()>* function;
+    TaskGroup* group;
+};
+
+void execute(const Task& task)
+{
+    try
+    {
+        (*task.function)();
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(task.group->mutex);
+        if (!task.group->error)
+            task.group->error = std::current_exception();
+    }
+    task.group->remaining.fetch_sub(1, std::memory_order_release);
+}
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t workers);
+    ~ThreadPool();
+
+    void submit(const Task& task);
+    //Wykonuje jedno oczekujące zadanie, zwraca false, jeśli żadnego nie było
+    bool runOne();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::size_t ownQueue() const;
+    bool pop(Task& task);
+    void work(std::size_t index);
+
+    //queues[i] dla i < liczby wątków - kolejki wątków puli, ostatnia - wspólna
+    //dla wątków spoza puli
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> queued;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping;
+};
+
+//Indeks wątku w puli (threads.size() dla wątków spoza puli)
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local std::size_t currentIndex = 0;
+
+ThreadPool::ThreadPool(std::size_t workers)
+    : queued(0), stopping(false)
+{
+    for (std::size_t i = 0; i <= workers; i++)
+        queues.push_back(std::unique_ptr<Queue>(new Queue));
+    for (std::size_t i = 0; i < workers; i++)
+        threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+std::size_t ThreadPool::ownQueue() const
+{
+    return currentPool == this ? currentIndex : threads.size();
+}
+
+void ThreadPool::submit(const Task& task)
+{
+    Queue& queue = *queues[ownQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    queued.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::pop(Task& task)
+{
+    if (queued.load() == 0)
+        return false;
+    const std::size_t own = ownQueue();
+    {
+        Queue& queue = *queues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < queues.size(); i++)
+    {
+        Queue& queue = *queues[(own + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runOne()
+{
+    Task task;
+    if (!pop(task))
+        return false;
+    execute(task);
+    return true;
+}
+
+void ThreadPool::work(std::size_t index)
+{
+    currentPool = this;
+    currentIndex = index;
+    for (;;)
+    {
+        if (runOne())
+            continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0)
+            return;
+    }
+}
+
+std::size_t limit = 1;
+std::unique_ptr<ThreadPool> pool;
+
+}
+
+std::size_t parallelism()
+{
+    return limit;
+}
+
+void parallelInvoke(const std::function<void()>* tasks, std::size_t count)
+{
+    if (!pool || count <= 1)
+    {
+        for (std::size_t i = 0; i < count; i++)
+            tasks[i]();
+        return;
+    }
+
+    TaskGroup group;
+    group.remaining.store(count);
+    //Pierwsze zadanie wykonuje wątek wywołujący, pozostałe trafiają do kolejki
+    for (std::size_t i = 1; i < count; i++)
+        pool->submit(Task{&tasks[i], &group});
+    execute(Task{&tasks[0], &group});
+    while (group.remaining.load(std::memory_order_acquire) > 0)
+    {
+        if (!pool->runOne())
+            std::this_thread::yield();
+    }
+    if (group.error)
+        std::rethrow_exception(group.error);
+}
+
+void parallelFor(std::size_t n, std::size_t grain,
+                 const std::function<void(std::size_t, std::size_t)>& body)
+{
+    //Kilka przedziałów na wątek wyrównuje nierówne tempo wątków
+    const std::size_t chunks = std::min(4 * parallelism(), std::max<std::size_t>(n / std::max<std::size_t>(grain, 1), 1));
+    if (chunks <= 1)
+    {
+        body(0, n);
+        return;
+    }
+    std::vector<std::function<void()>> tasks(chunks);
+    for (std::size_t i = 0; i < chunks; i++)
+    {
+        const std::size_t begin = n * i / chunks;
+        const std::size_t end = n * (i + 1) / chunks;
+        tasks[i] = [&body, begin, end] { body(begin, end); };
+    }
+    parallelInvoke(tasks.data(), chunks);
+}
+
+}
+
+void setThreadLimit(unsigned count)
+{
+    if (count == 0)
+        count = std::max(1u, std::thread::hardware_concurrency());
+    vlikernel::pool.reset();
+    vlikernel::limit = count;
+    if (count > 1)
+        vlikernel::pool.reset(new vlikernel::ThreadPool(count - 1));
+}
+
+unsigned threadLimit()
+{
+    return static_cast<unsigned> (vlikernel::limit);
+}
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "very_long_int.h"
+#include "very_long_int_kernels.h"
+
+/**
+ * Potęgowanie oraz pierwiastki całkowite.
+ *
+ * pow podnosi do kwadratu osobną procedurą (sqr), która liczy każdy iloczyn
+ * cyfr mieszanych raz; bufor wyniku i bufor pomocniczy są alokowane jednorazowo.
+ *
+ * iroot wyznacza pierwiastek metodą Newtona z rosnącą precyzją: pierwiastek
+ * z najstarszej połowy bitów (wyznaczony tak samo) daje przybliżenie z nadmiarem,
+ * które po jednym kroku Newtona jest dokładne z dokładnością do kilku jedności.
+ * Koszt jest więc rzędu kilku dzieleń pełnej długości, a nie log(bits) z nich.
+ */
+namespace
+{
+
+//Najmniejsza liczba bitów r taka, że pierwiastek k-tego stopnia z x < 2^r dla x < 2^bits
+unsigned long long rootBits(unsigned long long bits, unsigned long long k)
+{
+    return (bits - 1) / k + 1;
+}
+
+unsigned long long bitLength(unsigned long long x)
+{
+    return std::numeric_limits<unsigned long long>::digits - vlikernel::countLeadingZeros(x);
+}
+
+//Krok Newtona dla y^k = x: ((k - 1) y + x / y^(k - 1)) / k
+VeryLongInt newtonStep(const VeryLongInt& x, const VeryLongInt& y, unsigned long long k)
+{
+    if (k == 2)
+        return (y + x / y) >> 1;
+    return (y * (k - 1) + x / pow(y, k - 1)) / k;
+}
+
+//Dla y nie mniejszego od pierwiastka kolejne kroki Newtona maleją aż do pierwiastka
+VeryLongInt newtonFromAbove(const VeryLongInt& x, VeryLongInt y, unsigned long long k)
+{
+    for (;;)
+    {
+        VeryLongInt z = newtonStep(x, y, k);
+        if (z >= y)
+            return y;
+        y = std::move(z);
+    }
+}
+
+//Czy y^k <= x dla y >= 1
+bool powerAtMost(BaseType y, unsigned long long k, BaseType x)
+{
+    if (y == 1)
+        return true;
+    BaseType power = 1;
+    for (unsigned long long i = 0; i < k; i++)
+    {
+        if (__builtin_mul_overflow(power, y, &power) || power > x)
+            return false;
+    }
+    return true;
+}
+
+//Pierwiastek dla x < 2^bits wyznaczany bit po bicie; wynik ma rootBits(bits, k) bitów
+template <typename AtMost>
+BaseType rootBySearch(unsigned long long bits, unsigned long long k, AtMost atMost)
+{
+    BaseType y = 0;
+    for (unsigned long long bit = rootBits(bits, k); bit > 0; bit--)
+    {
+        BaseType candidate = y | (static_cast<BaseType> (1) << (bit - 1));
+        if (atMost(candidate))
+            y = candidate;
+    }
+    return y;
+}
+
+}
+
+VeryLongInt pow(const VeryLongInt& base, unsigned long long exponent)
+{
+    if (base.isNaN)
+        return NaN();
+    if (exponent == 0)
+        return 1;
+    if (exponent == 1 || (base.storage.size() == 1 && base.storage[0] <= 1))
+        return base;
+    if (exponent == 2)
+    {
+        //mul rozpoznaje kwadrat po identycznych argumentach
+        VeryLongInt result;
+        result.assignProduct(base, base);
+        return result;
+    }
+
+    //base = odd * 2^shift, a potęga 2^shift to tylko przesunięcie wyniku
+    std::size_t zeroLimbs = 0;
+    while (base.storage[zeroLimbs] == 0)
+        zeroLimbs++;
+    const unsigned long long shift = zeroLimbs * vlikernel::baseBits
+                                     + __builtin_ctzll(base.storage[zeroLimbs]);
+    VeryLongInt shifted;
+    if (shift > 0)
+        shifted = base >> shift;
+    const VeryLongInt& odd = shift > 0 ? shifted : base;
+    const BaseType* xp = odd.storage.data();
+    const std::size_t xn = odd.storage.size();
+    if (xn == 1 && xp[0] == 1)
+        return VeryLongInt(1) << (shift * exponent);
+
+    //Wynik ma mniej niż bits * exponent bitów; kwadrat wyniku pośredniego lub jego
+    //iloczyn z podstawą przekracza tę liczbę cyfr co najwyżej o jedną
+    const unsigned long long bits = (xn - 1) * vlikernel::baseBits + bitLength(xp[xn - 1]);
+    const std::size_t limit = (bits * exponent + vlikernel::baseBits - 1) / vlikernel::baseBits + 2;
+
+    //Potęgowanie od najstarszego bitu wykładnika, wyniki na przemian w buforze
+    //wyniku i w buforze pomocniczym
+    VeryLongInt result;
+    result.storage.resize(limit);
+    result.isNaN = false;
+    vlikernel::ScratchVector buffer(limit, limbResource());
+    BaseType* current = result.storage.data();
+    BaseType* next = buffer.data();
+    std::copy(xp, xp + xn, current);
+    std::size_t n = xn;
+    for (unsigned long long bit = bitLength(exponent) - 1; bit > 0; bit--)
+    {
+        vlikernel::sqr(next, current, n);
+        n *= 2;
+        while (next[n - 1] == 0)
+            n--;
+        if ((exponent >> (bit - 1)) & 1)
+        {
+            vlikernel::mul(current, next, n, xp, xn);
+            n += xn;
+            while (current[n - 1] == 0)
+                n--;
+        }
+        else
+            std::swap(current, next);
+    }
+
+    if (current != result.storage.data())
+        std::copy(current, current + n, result.storage.data());
+    result.storage.resize(n);
+    if (shift > 0)
+        result <<= shift * exponent;
+    return result;
+}
+
+VeryLongInt isqrt(const VeryLongInt& x)
+{
+    return iroot(x, 2);
+}
+
+VeryLongInt iroot(const VeryLongInt& x, unsigned long long k)
+{
+    if (x.isNaN || k == 0)
+        return NaN();
+    if (k == 1 || x <= 1)
+        return x;
+    const unsigned long long bits = x.numberOfBinaryDigits();
+    //x < 2^bits <= 2^k, więc pierwiastek jest mniejszy od 2
+    if (bits <= k)
+        return 1;
+
+    //Pierwiastek z x >> (k m) ma o m bitów mniej niż wynik; po przesunięciu o m bitów
+    //i dodaniu 2^m jest przybliżeniem z nadmiarem o błędzie co najwyżej 2^m.
+    //Krok Newtona zostawia błąd rzędu k 2^(2m - rootBits), stąd wybór m - precyzja
+    //niemal podwaja się z każdym poziomem. Poziomy wyznaczane są od pełnej liczby
+    //do prefiksu mieszczącego się w jednej cyfrze (lub o pierwiastku do 32 bitów).
+    std::vector<unsigned long long> steps;
+    unsigned long long prefixBits = bits;
+    unsigned long long dropped = 0;
+    const unsigned long long kBits = bitLength(k);
+    while (prefixBits > static_cast<unsigned long long> (vlikernel::baseBits) && rootBits(prefixBits, k) > 32)
+    {
+        const unsigned long long resultBits = rootBits(prefixBits, k);
+        const unsigned long long m = resultBits > kBits + 2 ? (resultBits - kBits) / 2 : 1;
+        steps.push_back(m);
+        dropped += k * m;
+        prefixBits -= k * m;
+    }
+
+    const VeryLongInt prefix = x >> dropped;
+    VeryLongInt y;
+    if (prefixBits <= static_cast<unsigned long long> (vlikernel::baseBits))
+    {
+        const BaseType value = prefix.storage[0];
+        y = rootBySearch(prefixBits, k, [&](BaseType c) { return powerAtMost(c, k, value); });
+    }
+    else
+        y = rootBySearch(prefixBits, k, [&](BaseType c) { return pow(VeryLongInt(c), k) <= prefix; });
+
+    for (std::size_t i = steps.size(); i > 0; i--)
+    {
+        dropped -= k * steps[i - 1];
+        const VeryLongInt part = x >> dropped;
+        y += 1;
+        y <<= steps[i - 1];
+        y = newtonFromAbove(part, newtonStep(part, y, k), k);
+    }
+    return y;
+}
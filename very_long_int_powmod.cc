@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <assert.h>
+#include "very_long_int.h"
+#include "very_long_int_kernels.h"
+
+/**
+ * Potęgowanie modularne. Dla nieparzystego modułu mnożenia wykonywane są
+ * w reprezentacji Montgomery'ego (x -> x * B^n mod m), w której redukcja modulo m
+ * sprowadza się do n mnożeń przez cyfrę i przesunięcia zamiast dzielenia.
+ * Wykładnik przetwarzany jest metodą okna przesuwnego: dla okna k bitów
+ * potrzeba 2^(k-1) nieparzystych potęg podstawy i około bits / (k + 1) mnożeń
+ * oprócz podnoszeń do kwadratu. Cała pamięć robocza alokowana jest przed pętlą.
+ */
+namespace vlikernel
+{
+
+BaseType inverseLimb(BaseType m)
+{
+    assert(m % 2 == 1);
+    //m * m = 1 mod 8, więc x = m jest odwrotnością z dokładnością do 3 bitów;
+    //każdy krok Newtona x = x * (2 - m * x) podwaja liczbę poprawnych bitów
+    BaseType x = m;
+    for (int i = 0; i < 5; i++)
+        x *= 2 - m * x;
+    return x;
+}
+
+BaseType montgomeryInverse(BaseType m)
+{
+    return 0 - inverseLimb(m);
+}
+
+void montgomeryReduce(BaseType* rp, BaseType* tp, const BaseType* mp, std::size_t n,
+                      BaseType inverse)
+{
+    BaseType high = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        //Dodanie u * m * B^i zeruje cyfrę tp[i], nie zmieniając reszty modulo m
+        BaseType u = tp[i] * inverse;
+        BaseType carry = addMul1(tp + i, mp, n, u);
+        high += add1(tp + i + n, tp + i + n, n - i, carry);
+    }
+    //tp[n..2n) + high * B^n < 2m, wystarczy więc co najwyżej jedno odejmowanie
+    if (high != 0 || compareN(tp + n, mp, n) >= 0)
+        subN(rp, tp + n, mp, n);
+    else
+        std::copy(tp + n, tp + 2 * n, rp);
+}
+
+namespace
+{
+
+bool exponentBit(const BaseType* ep, std::size_t i)
+{
+    return (ep[i / baseBits] >> (i % baseBits)) & 1;
+}
+
+//Rozmiar okna minimalizujący łączną liczbę mnożeń dla wykładnika o danej liczbie bitów
+std::size_t windowSize(std::size_t bits)
+{
+    if (bits <= 24)
+        return 1;
+    if (bits <= 80)
+        return 3;
+    if (bits <= 240)
+        return 4;
+    if (bits <= 672)
+        return 5;
+    if (bits <= 1792)
+        return 6;
+    return 7;
+}
+
+std::size_t windowTableSize(std::size_t k, std::size_t n)
+{
+    return (static_cast<std::size_t> (1) << (k - 1)) * n;
+}
+
+//rp[0..n) = xp[0..n)^ep[0..en), gdzie mulMod(r, a, b) mnoży w wybranej reprezentacji
+//(r może pokrywać się z a i b). table - miejsce na windowTableSize(k, n) cyfr.
+template <typename MulMod>
+void windowPower(BaseType* rp, const BaseType* xp, const BaseType* ep, std::size_t en,
+                 std::size_t n, BaseType* table, std::size_t k, MulMod mulMod)
+{
+    //table[i] = x^(2i + 1)
+    std::copy(xp, xp + n, table);
+    if (k > 1)
+    {
+        mulMod(rp, xp, xp);
+        for (std::size_t i = 1; i < (static_cast<std::size_t> (1) << (k - 1)); i++)
+            mulMod(table + i * n, table + (i - 1) * n, rp);
+    }
+
+    const std::size_t bits = en * baseBits - countLeadingZeros(ep[en - 1]);
+    bool started = false;
+    std::size_t i = bits;
+    while (i > 0)
+    {
+        if (!exponentBit(ep, i - 1))
+        {
+            //Najstarszy bit jest jedynką, więc wynik jest już zainicjalizowany
+            mulMod(rp, rp, rp);
+            i--;
+            continue;
+        }
+        //Okno bitów [j, i) o długości co najwyżej k, kończące się jedynką
+        std::size_t j = i > k ? i - k : 0;
+        while (!exponentBit(ep, j))
+            j++;
+        std::size_t value = 0;
+        for (std::size_t t = i; t > j; t--)
+            value = (value << 1) | exponentBit(ep, t - 1);
+
+        const BaseType* power = table + (value >> 1) * n;
+        if (started)
+        {
+            for (std::size_t t = j; t < i; t++)
+                mulMod(rp, rp, rp);
+            mulMod(rp, rp, power);
+        }
+        else
+        {
+            std::copy(power, power + n, rp);
+            started = true;
+        }
+        i = j;
+    }
+}
+
+}
+
+void powmodOdd(BaseType* rp, const BaseType* xp, const BaseType* ep, std::size_t en,
+               const BaseType* mp, const BaseType* r2p, std::size_t n, BaseType inverse)
+{
+    const std::size_t k = windowSize(en * baseBits);
+    const std::size_t tableSize = windowTableSize(k, n);
+    ScratchVector work(tableSize + 3 * n + mulNScratchSize(n), limbResource());
+    BaseType* table = work.data();
+    BaseType* tp = table + tableSize;
+    BaseType* xm = tp + 2 * n;
+    BaseType* scratch = xm + n;
+
+    auto mulMod = [&](BaseType* r, const BaseType* a, const BaseType* b)
+    {
+        mulN(tp, a, b, n, scratch);
+        montgomeryReduce(r, tp, mp, n, inverse);
+    };
+
+    //x * B^n mod m = REDC(x * B^2n mod m)
+    mulMod(xm, xp, r2p);
+    windowPower(rp, xm, ep, en, n, table, k, mulMod);
+    //Powrót do zwykłej reprezentacji: REDC(wynik * 1)
+    std::copy(rp, rp + n, tp);
+    std::fill(tp + n, tp + 2 * n, 0);
+    montgomeryReduce(rp, tp, mp, n, inverse);
+}
+
+void powmodPowerOfTwo(BaseType* rp, const BaseType* xp, const BaseType* ep, std::size_t en,
+                      std::size_t bits)
+{
+    const std::size_t n = (bits + baseBits - 1) / baseBits;
+    const std::size_t topBits = bits - (n - 1) * baseBits;
+    const BaseType mask = (topBits == static_cast<std::size_t> (baseBits))
+                          ? ~static_cast<BaseType> (0)
+                          : (static_cast<BaseType> (1) << topBits) - 1;
+
+    const std::size_t k = windowSize(en * baseBits);
+    const std::size_t tableSize = windowTableSize(k, n);
+    ScratchVector work(tableSize + 3 * n + mulNScratchSize(n), limbResource());
+    BaseType* table = work.data();
+    BaseType* tp = table + tableSize;
+    BaseType* xm = tp + 2 * n;
+    BaseType* scratch = xm + n;
+
+    //Redukcja modulo 2^bits to obcięcie iloczynu do najmłodszych bitów
+    auto mulMod = [&](BaseType* r, const BaseType* a, const BaseType* b)
+    {
+        mulN(tp, a, b, n, scratch);
+        std::copy(tp, tp + n, r);
+        r[n - 1] &= mask;
+    };
+
+    std::copy(xp, xp + n, xm);
+    xm[n - 1] &= mask;
+    windowPower(rp, xm, ep, en, n, table, k, mulMod);
+}
+
+}
+
+namespace
+{
+
+//x mod 2^bits
+VeryLongInt lowBits(const VeryLongInt& x, unsigned long long bits)
+{
+    return x - ((x >> bits) << bits);
+}
+
+//Odwrotność nieparzystego q modulo 2^bits metodą Newtona; q0 - najmłodsza cyfra q
+VeryLongInt inverseModPowerOfTwo(const VeryLongInt& q, BaseType q0, unsigned long long bits)
+{
+    VeryLongInt y = vlikernel::inverseLimb(q0);
+    for (unsigned long long precision = vlikernel::baseBits; precision < bits; precision *= 2)
+    {
+        //y = y * (2 - q * y) mod 2^(2 * precision)
+        const unsigned long long next = 2 * precision;
+        VeryLongInt e = lowBits(q * y, next);
+        y = lowBits(y * ((VeryLongInt(1) << next) + 2 - e), next);
+    }
+    return lowBits(y, bits);
+}
+
+}
+
+VeryLongIntMontgomery::VeryLongIntMontgomery(const VeryLongInt& modulus)
+    : mod(modulus), inverse(0)
+{
+    if (!mod.isValid() || mod.storage[0] % 2 == 0 || mod == 1)
+    {
+        mod = NaN();
+        return;
+    }
+    const std::size_t n = mod.storage.size();
+    VeryLongInt r2 = (VeryLongInt(1) << (2 * n * vlikernel::baseBits)) % mod;
+    squaredRadix = r2.storage;
+    squaredRadix.resize(n);
+    inverse = vlikernel::montgomeryInverse(mod.storage[0]);
+}
+
+bool VeryLongIntMontgomery::isValid() const
+{
+    return mod.isValid();
+}
+
+const VeryLongInt& VeryLongIntMontgomery::modulus() const
+{
+    return mod;
+}
+
+VeryLongInt VeryLongIntMontgomery::powmod(const VeryLongInt& base, const VeryLongInt& exponent) const
+{
+    if (!isValid() || base.isNaN || exponent.isNaN)
+        return NaN();
+    if (exponent == 0)
+        return 1;
+
+    const std::size_t n = mod.storage.size();
+    VeryLongInt x = base % mod;
+    x.storage.resize(n);
+    VeryLongInt result;
+    result.storage.resize(n);
+    vlikernel::powmodOdd(result.storage.data(), x.storage.data(),
+                         exponent.storage.data(), exponent.storage.size(),
+                         mod.storage.data(), squaredRadix.data(), n, inverse);
+    result.truncate();
+    return result;
+}
+
+VeryLongInt powmod(const VeryLongInt& base, const VeryLongInt& exponent, const VeryLongInt& modulus)
+{
+    if (base.isNaN || exponent.isNaN || modulus.isNaN || modulus == 0)
+        return NaN();
+    if (modulus == 1)
+        return 0;
+    if (modulus.storage[0] % 2 == 1)
+        return VeryLongIntMontgomery(modulus).powmod(base, exponent);
+    if (exponent == 0)
+        return 1;
+
+    //Moduł parzysty: m = 2^k * q, q nieparzyste. Wynik liczymy osobno modulo q
+    //(Montgomery) i modulo 2^k, a następnie łączymy z chińskiego twierdzenia o resztach.
+    std::size_t zeroLimbs = 0;
+    while (modulus.storage[zeroLimbs] == 0)
+        zeroLimbs++;
+    const unsigned long long k = zeroLimbs * vlikernel::baseBits + __builtin_ctzll(modulus.storage[zeroLimbs]);
+    const VeryLongInt q = modulus >> k;
+
+    const std::size_t kn = (k + vlikernel::baseBits - 1) / vlikernel::baseBits;
+    VeryLongInt x = base;
+    x.storage.resize(std::max(kn, x.storage.size()));
+    VeryLongInt x2;
+    x2.storage.resize(kn);
+    vlikernel::powmodPowerOfTwo(x2.storage.data(), x.storage.data(),
+                                exponent.storage.data(), exponent.storage.size(), k);
+    x2.truncate();
+    if (q == 1)
+        return x2;
+
+    VeryLongInt x1 = VeryLongIntMontgomery(q).powmod(base, exponent);
+    //x = x1 + q * t, gdzie t = (x2 - x1) * q^(-1) mod 2^k
+    VeryLongInt t = lowBits(x1, k);
+    t = (x2 >= t) ? x2 - t : x2 + (VeryLongInt(1) << k) - t;
+    t = lowBits(t * inverseModPowerOfTwo(q, q.storage[0], k), k);
+    return x1 + q * t;
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include "very_long_int_storage.h"
+
+namespace
+{
+thread_local std::pmr::memory_resource* currentResource = nullptr;
+}
+
+std::pmr::memory_resource* limbResource()
+{
+    return currentResource != nullptr ? currentResource : std::pmr::get_default_resource();
+}
+
+std::pmr::memory_resource* setLimbResource(std::pmr::memory_resource* resource)
+{
+    std::pmr::memory_resource* previous = limbResource();
+    currentResource = resource;
+    return previous;
+}
+
+LimbStorage::LimbStorage(const LimbStorage& other, std::pmr::memory_resource* resource)
+    : memory(resource), length(0), space(inlineCapacity)
+{
+    reserve(other.length);
+    std::copy(other.begin(), other.end(), data());
+    length = other.length;
+}
+
+//Przeniesienie zabiera bufor razem z zasobem, z którego pochodzi
+//(cyfry widoku na cudzy bufor są kopiowane do bufora z bieżącego zasobu)
+LimbStorage::LimbStorage(LimbStorage&& other) noexcept
+    : memory(other.isBorrowed() ? limbResource() : other.memory), length(0), space(inlineCapacity)
+{
+    stealFrom(other);
+}
+
+LimbStorage::~LimbStorage()
+{
+    release();
+}
+
+LimbStorage& LimbStorage::operator=(const LimbStorage& other)
+{
+    if (this != &other)
+    {
+        //Istniejący bufor jest używany ponownie, jeśli wystarcza
+        reserve(other.length);
+        std::copy(other.begin(), other.end(), data());
+        length = other.length;
+    }
+    return *this;
+}
+
+LimbStorage& LimbStorage::operator=(LimbStorage&& other)
+{
+    if (this != &other)
+        stealFrom(other);
+    return *this;
+}
+
+void LimbStorage::resize(std::size_t n, BaseType value)
+{
+    if (n > space)
+        grow(n);
+    if (n > length)
+        std::fill(data() + length, data() + n, value);
+    length = n;
+}
+
+//Każda ze stron zachowuje swój zasób; przy różnych zasobach cyfry są kopiowane
+void LimbStorage::swap(LimbStorage& other)
+{
+    LimbStorage tmp(std::move(other));
+    other.stealFrom(*this);
+    stealFrom(tmp);
+}
+
+void LimbStorage::grow(std::size_t n)
+{
+    std::size_t newSpace = std::max(n, 2 * space);
+    BaseType* buffer = static_cast<BaseType*> (memory->allocate(newSpace * sizeof(BaseType), alignof(BaseType)));
+    std::copy(begin(), end(), buffer);
+    release();
+    heap = buffer;
+    space = newSpace;
+}
+
+void LimbStorage::release()
+{
+    if (!isInline() && !isBorrowed())
+        memory->deallocate(heap, space * sizeof(BaseType), alignof(BaseType));
+    space = inlineCapacity;
+}
+
+//Przejmuje zawartość other, other zostaje pusty. Bufor na stercie przejmowany jest
+//bez kopiowania tylko wtedy, gdy pochodzi z tego samego zasobu.
+void LimbStorage::stealFrom(LimbStorage& other)
+{
+    if (!other.isInline() && !other.isBorrowed() && *memory == *other.memory)
+    {
+        release();
+        heap = other.heap;
+        space = other.space;
+        other.space = inlineCapacity;
+    }
+    else
+    {
+        //Gdy cyfry mieszczą się wewnątrz obiektu, nie ma potrzeby trzymać bufora
+        if (other.length <= inlineCapacity)
+            release();
+        else
+            reserve(other.length);
+        std::copy(other.begin(), other.end(), data());
+    }
+    length = other.length;
+    other.length = 0;
+}
@@ -0,0 +1,132 @@
+#ifndef VERY_LONG_INT_STORAGE_H
+#define VERY_LONG_INT_STORAGE_H
+
+#include <cstddef>
+#include <memory_resource>
+
+typedef unsigned long long BaseType;
+
+/**
+ * Zasób pamięci (std::pmr::memory_resource), z którego alokują cyfry liczby tworzone
+ * w bieżącym wątku. Domyślnie jest to std::pmr::get_default_resource().
+ *
+ * Pozwala wykonać całe obliczenie np. na std::pmr::monotonic_buffer_resource i zwolnić
+ * wszystkie wyniki pośrednie jednym ruchem. Każda liczba zapamiętuje zasób, z którego
+ * pochodzi, a przypisanie do liczby z innym zasobem kopiuje cyfry, więc wynik
+ * przypisany do liczby utworzonej poza zakresem nie odwołuje się do zasobu.
+ * Zasób musi żyć dłużej niż wszystkie liczby z niego korzystające.
+ */
+std::pmr::memory_resource* limbResource();
+//Ustawia zasób dla bieżącego wątku (nullptr - domyślny), zwraca poprzedni
+std::pmr::memory_resource* setLimbResource(std::pmr::memory_resource* resource);
+
+//Ustawia zasób pamięci na czas życia obiektu (RAII)
+class LimbResourceScope
+{
+public:
+    explicit LimbResourceScope(std::pmr::memory_resource* resource)
+        : previous(setLimbResource(resource)) {}
+    ~LimbResourceScope() { setLimbResource(previous); }
+
+    LimbResourceScope(const LimbResourceScope&) = delete;
+    LimbResourceScope& operator=(const LimbResourceScope&) = delete;
+
+private:
+    std::pmr::memory_resource* previous;
+};
+
+/**
+ * Tablica cyfr liczby VeryLongInt z miejscem na kilka cyfr wewnątrz obiektu.
+ *
+ * Dopóki liczba mieści się w inlineCapacity cyfrach, żadna pamięć nie jest
+ * alokowana na stercie - dotyczy to m.in. wszystkich liczb tworzonych niejawnie
+ * z typów wbudowanych. Większe liczby trzymane są w buforze alokowanym z zasobu
+ * pamięci (patrz limbResource()), który rośnie geometrycznie. Interfejs jest
+ * podzbiorem interfejsu std::vector; zasób zachowuje się jak w kontenerach std::pmr
+ * (nie jest przenoszony przy przypisaniu).
+ */
+class LimbStorage
+{
+public:
+    static const std::size_t inlineCapacity = 4;
+
+    LimbStorage() : LimbStorage(limbResource()) {}
+    explicit LimbStorage(std::pmr::memory_resource* resource)
+        : memory(resource), length(0), space(inlineCapacity) {}
+    LimbStorage(const LimbStorage& other) : LimbStorage(other, limbResource()) {}
+    LimbStorage(const LimbStorage& other, std::pmr::memory_resource* resource);
+    LimbStorage(LimbStorage&& other) noexcept;
+    ~LimbStorage();
+
+    //Znacznik konstruktora widoku na cudzy bufor cyfr
+    struct Borrowed {};
+    //Widok na limbs[0..n) bez kopiowania i bez przejmowania własności (n > 0). Taki obiekt
+    //wolno tylko odczytywać, a bufor musi żyć dłużej niż on; kopia lub przeniesienie
+    //tworzy własny bufor.
+    LimbStorage(Borrowed, const BaseType* limbs, std::size_t n)
+        : memory(nullptr), length(n), space(0), heap(const_cast<BaseType*> (limbs)) {}
+
+    LimbStorage& operator=(const LimbStorage& other);
+    LimbStorage& operator=(LimbStorage&& other);
+
+    std::size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    std::size_t capacity() const { return space; }
+    std::pmr::memory_resource* resource() const { return memory; }
+
+    BaseType* data() { return isInline() ? local : heap; }
+    const BaseType* data() const { return isInline() ? local : heap; }
+
+    BaseType& operator[](std::size_t i) { return data()[i]; }
+    const BaseType& operator[](std::size_t i) const { return data()[i]; }
+    BaseType& front() { return data()[0]; }
+    const BaseType& front() const { return data()[0]; }
+    BaseType& back() { return data()[length - 1]; }
+    const BaseType& back() const { return data()[length - 1]; }
+
+    BaseType* begin() { return data(); }
+    const BaseType* begin() const { return data(); }
+    BaseType* end() { return data() + length; }
+    const BaseType* end() const { return data() + length; }
+
+    void push_back(BaseType value)
+    {
+        if (length == space)
+            grow(length + 1);
+        data()[length++] = value;
+    }
+
+    void pop_back() { length--; }
+    void clear() { length = 0; }
+
+    void reserve(std::size_t n)
+    {
+        if (n > space)
+            grow(n);
+    }
+
+    //Nowe cyfry (jeśli rozmiar rośnie) przyjmują wartość value
+    void resize(std::size_t n, BaseType value = 0);
+
+    void swap(LimbStorage& other);
+
+private:
+    //Bufor na stercie ma zawsze więcej niż inlineCapacity cyfr,
+    //więc pojemność jednoznacznie wskazuje, gdzie leżą dane
+    bool isInline() const { return space == inlineCapacity; }
+    bool isBorrowed() const { return memory == nullptr; }
+    void grow(std::size_t n);
+    void release();
+    void stealFrom(LimbStorage& other);
+
+    std::pmr::memory_resource* memory;
+    std::size_t length;
+    std::size_t space;
+    union
+    {
+        BaseType* heap;
+        BaseType local[inlineCapacity];
+    };
+};
+
+#endif